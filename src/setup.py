@@ -1,12 +1,16 @@
 #!/usr/bin/env python
 
-from distutils.core import setup, Extension
+try:
+	from setuptools import setup, Extension
+except ImportError:
+	from distutils.core import setup, Extension
 
 classifiers = ['Development Status :: 5 - Production/Stable',
                'Operating System :: POSIX :: Linux',
                'License :: OSI Approved :: GNU General Public License v2 (GPLv2)',
                'Intended Audience :: Developers',
                'Programming Language :: Python :: 2.7',
+               'Programming Language :: Python :: 3',
                'Topic :: Software Development',
                'Topic :: System :: Hardware',
                'Topic :: System :: Hardware :: Hardware Drivers']
@@ -22,5 +26,5 @@ setup(	name	= "ssd1306_i2c",
 	license		= "GPLv2",
 	classifiers	= classifiers,
 	url		= "https://github.com/polkabana/bsb_ssd1306_i2c",
-	ext_modules	= [Extension("ssd1306_i2c", ["ssd1306_i2c_module.c"])]
+	ext_modules	= [Extension("ssd1306_i2c", ["ssd1306_i2c_module.c"], libraries = ["pthread", "rt"])]
 )
@@ -20,473 +20,5359 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <fcntl.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <linux/types.h>
 #include <linux/i2c.h>
 #include <linux/i2c-dev.h>
 #include "fonts.h"
 
+// USDT probes for perf/bpftrace, a single nop each while not attached.
+// Used if sys/sdt.h is found, build with -DSSD1306_NO_SDT to leave them out.
+#if !defined(SSD1306_NO_SDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SSD1306_SDT
+#endif
+#endif
+
+#ifdef SSD1306_SDT
+#define PROBE1(name, a)	DTRACE_PROBE1(ssd1306_i2c, name, a)
+#define PROBE2(name, a, b)	DTRACE_PROBE2(ssd1306_i2c, name, a, b)
+#define PROBE3(name, a, b, c)	DTRACE_PROBE3(ssd1306_i2c, name, a, b, c)
+#else
+#define PROBE1(name, a)
+#define PROBE2(name, a, b)
+#define PROBE3(name, a, b, c)
+#endif
+
+// Python 2 and 3 from the same source
+#if PY_MAJOR_VERSION >= 3
+#define PyInt_FromLong	PyLong_FromLong
+#define PyString_FromString(s)	PyUnicode_DecodeLatin1((s), strlen(s), NULL)	// text is glyph codes
+#define PyString_Check	PyUnicode_Check
+#define CHAR_FORMAT	"C|iii"	// str of length 1, code point as int
+typedef int char_arg;
+#else
+#define CHAR_FORMAT	"c|iii"
+typedef char char_arg;
+#endif
+
+// METH_FASTCALL is public API since 3.7, hot methods use it there
+#if PY_VERSION_HEX >= 0x03070000
+#define SSD1306_FASTCALL
+#define HOT_METHOD(name, fast, func, flags, doc)	{name, (PyCFunction)(void (*)(void))fast, METH_FASTCALL | METH_KEYWORDS, doc}
+#else
+#define HOT_METHOD(name, fast, func, flags, doc)	{name, (PyCFunction)func, flags, doc}
+#endif
+
 #define I2CDEV_MAXPATH	128
 
 #define SSD1306_WIDTH	128
 #define SSD1306_HEIGHT	64
 #define SSD1306_FBSIZE	SSD1306_WIDTH * SSD1306_HEIGHT / 8	//	128x8
 #define SSD1306_MAXROW	8
+#define SSD1306_MAXPAGES	16	// pages of 64x128 portrait buffer
 
 //command macro
 #define SSD1306_CMD_DISPLAY_OFF 0xAE	// turn off the OLED
 #define SSD1306_CMD_DISPLAY_ON 0xAF		// turn on oled panel
+#define SSD1306_CMD_SCROLL_RIGHT 0x26	// continuous horizontal scroll setup
+#define SSD1306_CMD_SCROLL_LEFT 0x27
+#define SSD1306_CMD_SCROLL_VRIGHT 0x29	// continuous vertical and horizontal scroll setup
+#define SSD1306_CMD_SCROLL_VLEFT 0x2A
+#define SSD1306_CMD_SCROLL_AREA 0xA3	// set vertical scroll area
+#define SSD1306_CMD_SCROLL_STOP 0x2E	// deactivate scroll
+#define SSD1306_CMD_SCROLL_START 0x2F	// activate scroll
+#define SSD1306_CMD_START_LINE 0x40	// set display start line, 40h-7Fh
+#define SSD1306_CMD_SEG_NORMAL 0xA0	// column 0 is SEG0
+#define SSD1306_CMD_SEG_REMAP 0xA1	// column 127 is SEG0
+#define SSD1306_CMD_COM_NORMAL 0xC0	// scan COM0 to COM63
+#define SSD1306_CMD_COM_REMAP 0xC8	// scan COM63 to COM0
+
+#define CONSOLE_LINE_MAX	128	// bytes per scrollback line
+
+#define SSD1306_RETRIES	3	// bus write attempts on EAGAIN or short write
+
+#define SSD1306_STATUS_OFF	0x40	// status byte: display is off
+
+// Snapshot file: header and panel RAM as last sent. Header: magic (8
+// bytes), stale page mask, I2C address, bus (2 bytes little endian), 4
+// reserved.
+#define SNAPSHOT_MAGIC	"SSD1306\x02"
+#define SNAPSHOT_STALE	8
+#define SNAPSHOT_ADDRESS	9
+#define SNAPSHOT_BUS	10
+#define SNAPSHOT_HEAD	16
+#define SNAPSHOT_SIZE	(SNAPSHOT_HEAD + SSD1306_FBSIZE)
+
+/*
+ * Frame stream of record() and play(), panel RAM layout:
+ * header: magic (8 bytes), frame count (4 bytes little endian), 4 reserved
+ * frame: window count n, then n times page, first column, length - 1 and
+ * the column bytes. Windows hold what changed since the previous frame,
+ * the first frame has all pages.
+ */
+#define STREAM_MAGIC	"SSD1306F"
+#define STREAM_HEAD	16
+
+// Round shapes
+#define SHAPE_MAX	32767	// radius limit of round shapes, keeps their math in range
+#define SHAPE_TOO_BIG	-2	// round shape result: radius above SHAPE_MAX
+
+// Drawing modes, mode()
+#define MODE_SET	0	// color 1 sets, color 0 clears pixels
+#define MODE_CLEAR	1	// clears pixels
+#define MODE_XOR	2	// color 1 toggles pixels
+#define MODE_INVERT	3	// draws with inverse color
+
+// Raster ops of drawing kernels, mode and color resolved
+#define ROP_NOP	0
+#define ROP_SET	1
+#define ROP_CLEAR	2
+#define ROP_XOR	3
+#define ROP_PATTERN	4	// flag of fill rops: only bits of the fill pattern
+
+static const uint8_t pattern_solid[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// Primitives counted by stats()
+#define PRIM_PIXEL	0
+#define PRIM_LINE	1
+#define PRIM_RECT	2
+#define PRIM_RECT_FILL	3
+#define PRIM_CIRCLE	4
+#define PRIM_CHAR	5
+#define PRIM_WRITE	6
+#define PRIM_BLIT	7
+#define PRIM_SCROLL_REGION	8
+#define PRIM_SPRITE	9
+#define PRIM_PIXELS	10
+#define PRIM_PLOT	11
+#define PRIM_CHART	12
+#define PRIM_CIRCLE_FILL	13
+#define PRIM_ELLIPSE	14
+#define PRIM_ELLIPSE_FILL	15
+#define PRIM_ROUND_RECT	16
+#define PRIM_ROUND_RECT_FILL	17
+#define PRIM_TRIANGLE	18
+#define PRIM_TRIANGLE_FILL	19
+#define PRIM_POLYGON	20
+#define PRIM_POLYGON_FILL	21
+#define PRIM_ARC	22
+#define PRIM_PIE_FILL	23
+#define PRIM_FLOOD_FILL	24
+#define PRIM_COUNT	25
 
+static const char *prim_names[PRIM_COUNT] = {
+	"pixel", "line", "rect", "rect_fill", "circle", "char", "write", "blit", "scroll_region", "sprite",
+	"pixels", "plot", "chart", "circle_fill", "ellipse", "ellipse_fill", "round_rect", "round_rect_fill",
+	"triangle", "triangle_fill", "polygon", "polygon_fill",
+	"arc", "pie_fill", "flood_fill"
+};
+
+#define STATS_HIST	24	// log2 buckets of flush time in us
+
+// Methods touching buffer or panel raise while a thread flushes it with
+// the GIL released (SSD1306Group.update(), run(), play())
+#define BUSY_CHECK(self) \
+	do { \
+		if ((self)->busy) { \
+			PyErr_SetString(PyExc_RuntimeError, "display is busy in a flush by another thread"); \
+			return NULL; \
+		} \
+	} while (0)
+
+// Python level primitive call: stats() count and prim__entry/exit probes
+#define PRIM_ENTRY(self, id)	do { (self)->calls[id]++; PROBE2(prim__entry, self, id); } while (0)
+#define PRIM_EXIT(self, id)	PROBE2(prim__exit, self, id)
+
+// blit() operations
+#define BLIT_COPY	0
+#define BLIT_OR	1
+#define BLIT_AND	2
+#define BLIT_XOR	3
+
+/*
+ * Sprite registered by sprite_add(): image and mask stored pre-shifted for
+ * every bit offset of y inside a page, so drawing is one masked byte store
+ * per column and page. Bytes under a shown sprite are kept for restore.
+ */
 typedef struct {
-	PyObject_HEAD
+	int w, h;
+	int pages;	/* pages covered at any bit offset */
+	uint8_t *data;	/* image r at r * pages * w, mask r at (8 + r) * pages * w; NULL if removed */
+	uint8_t *save;	/* buffer bytes under the sprite, pages * w */
+	int x, y;
+	int x0, y0, x1, y1;	/* clip rect when shown, save covers only this part */
+	int visible;
+	int lifted;	/* taken off while a sprite below it moves */
+} ssd1306_sprite;
+
+// Chart styles
+#define CHART_LINE	0	// sparkline, samples joined by vertical runs
+#define CHART_BAR	1	// bar from the bottom up to the sample
+#define CHART_BAND	2	// min/max band, run from low to high sample
+
+/*
+ * Chart added by chart_add(): ring of the last w samples shown one per
+ * column of rect x, y, w, h, newest at the right. Appending moves the
+ * plot left and draws only the new columns.
+ */
+typedef struct {
+	int x, y, w, h;
+	int x0, y0, x1, y1;	/* clip rect at chart_add(), columns and rows outside stay */
+	int style;
+	int color;	/* 1: set pixels on clear background, 0: inverse */
+	int *lo, *hi;	/* sample ring, w each, lo == hi except band; NULL if removed */
+	int head;	/* ring index of the oldest sample */
+	int count;	/* samples kept, up to w */
+	int fixed;	/* vmin, vmax given by chart_add(), else auto scale */
+	long long vmin, vmax;	/* value range mapped to rows y+h-1..y */
+} ssd1306_chart;
+
+#define VIEW_DEPTH	16	// push() levels
+#define TEXT_SIZE_MAX	4
+
+/*
+ * Drawing view: origin added to coordinates of drawing calls and clip rect
+ * all drawing stays in. Kernels take buffer coordinates and clip to it.
+ */
+typedef struct {
+	int ox, oy;
+	int x0, y0, x1, y1;	/* clip rect in buffer coordinates, inclusive */
+} ssd1306_view;
+
+/*
+ * Drawing state shared by Canvas and SSD1306: size, text settings and a
+ * page-major buffer (byte = 8 vertical pixels, width bytes per page) with
+ * changed column window of every page. All drawing code works on it.
+ */
+#define CANVAS_HEAD \
+	PyObject_HEAD \
+	int width; \
+	int height; \
+	unsigned char *font; \
+	int color, bg_color, char_spacing; \
+	int text_size;	/* glyph scale 1..TEXT_SIZE_MAX */ \
+	int mode; \
+	uint8_t pattern[8];	/* fill pattern, column bytes of x % 8 */ \
+	int patterned;	/* pattern is not solid */ \
+	int cursor_x; \
+	int cursor_y; \
+	unsigned char *frame; \
+	int *dirty_lo; \
+	int *dirty_hi; \
+	ssd1306_sprite *sprites; \
+	int sprite_count; \
+	ssd1306_chart *charts; \
+	int chart_count; \
+	ssd1306_view view; \
+	ssd1306_view views[VIEW_DEPTH];	/* saved by push() */ \
+	int view_depth; \
+	int busy;	/* SSD1306 flushed with the GIL released, see BUSY_CHECK */ \
+	unsigned long calls[PRIM_COUNT];	/* primitive calls for stats() */
+
+typedef struct {
+	CANVAS_HEAD
+} CanvasPyObject;
+
+#define CANVAS(o)	((CanvasPyObject *)(o))
+
+typedef struct {
+	CANVAS_HEAD
 	
 	int fd;	/* open file descriptor: /dev/i2c-X */	
-	uint8_t width;
-	uint8_t height;
+	int bus;
+	int address;
+	int io_errno;	/* first failed bus write since last check, 0 if none */
 
-	unsigned char *font;
-	int color, bg_color, char_spacing;
-	int cursor_x;
-	int cursor_y;
+	int scrolling;	/* hardware scroll engine is running */
+	int scroll_start, scroll_end;	/* pages whose GDDRAM is moved by the engine */
+
+	int console;	/* text console mode, write() appends to it */
+	int console_start;	/* page at the top of the display, start line / 8 */
+	int console_pages;	/* pages per text line: 1, 2, 4 or 8 */
+	int console_row;	/* text line of the cursor, 0 is top */
+	char *scrollback;	/* ring of text lines, CONSOLE_LINE_MAX bytes each */
+	int scrollback_size;
+	int scrollback_head;	/* line being written */
+	int scrollback_count;	/* complete lines kept before head */
+
+	int rotation;	/* 0, 90, 180 or 270 degrees */
+	int mirror_x, mirror_y;
+
+	int64_t frame_period;	/* run(): ns between frame deadlines */
+	int64_t run_start, run_last;	/* start of run() and end of last frame */
+	long frames, frames_skipped;
+	int64_t render_ns, flush_ns;	/* totals of frames */
+	int64_t late_max_ns;	/* frame start after its deadline */
+	double late_sq;	/* sum of squared lateness, ns^2 */
+
+	// stats() counters, cheap enough to be always on
+	unsigned long stat_frames;	/* flushes */
+	unsigned long stat_bytes, stat_transactions;	/* written to the bus */
+	unsigned long stat_syscalls, stat_errors;
+	unsigned long stat_flush_hist[STATS_HIST];	/* bucket n: flush took 2^n..2^(n+1)-1 us */
+
+	uint8_t *snapshot;	/* mmap of snapshot file, NULL if none */
+	uint8_t *shadow;	/* panel RAM as last sent, inside snapshot */
+	int shadow_stale;	/* bit per panel page whose RAM content is unknown */
+
+	FILE *rec;	/* frame stream being recorded, NULL if none */
+	uint8_t *rec_prev;	/* panel image of the last recorded frame */
+	unsigned long rec_frames;
+	int rec_errno;	/* failed stream write that stopped recording, 0 if none */
+
+	int page_lo[SSD1306_MAXPAGES];	/* dirty_lo, dirty_hi storage: */
+	int page_hi[SSD1306_MAXPAGES];	/* lo > hi if page is clean */
 	
-	unsigned char frame[SSD1306_FBSIZE];
+	unsigned char fb[SSD1306_FBSIZE];	/* 128x64, or 64x128 if rotated by 90/270 */
 } SSD1306PyObject;
 
-static PyMemberDef ssd1306_members[] = {
-	{"cursor_x", T_INT, offsetof(SSD1306PyObject, cursor_x), 0,
+static PyTypeObject CanvasObjectType;
+static PyTypeObject SSD1306ObjectType;
+
+static PyMemberDef canvas_members[] = {
+	{"cursor_x", T_INT, offsetof(CanvasPyObject, cursor_x), 0,
 		"Cursor X position"},
-	{"cursor_y", T_INT, offsetof(SSD1306PyObject, cursor_y), 0,
+	{"cursor_y", T_INT, offsetof(CanvasPyObject, cursor_y), 0,
 		"Cursor Y position"},
+	{"width", T_INT, offsetof(CanvasPyObject, width), READONLY,
+		"Buffer width"},
+	{"height", T_INT, offsetof(CanvasPyObject, height), READONLY,
+		"Buffer height"},
+	{NULL}  /* Sentinel */
+};
+
+static PyMemberDef ssd1306_members[] = {
+	{"rotation", T_INT, offsetof(SSD1306PyObject, rotation), READONLY,
+		"Display rotation in degrees"},
 	{NULL}  /* Sentinel */
 };
 
 
-static void ssd1306_command(SSD1306PyObject *self, uint8_t c);
-static void ssd1306_pixel(SSD1306PyObject *self, int x, int y, int color);
-static int ssd1306_char(SSD1306PyObject *self, unsigned char ch);
-static int ssd1306_charWidth(SSD1306PyObject *self, unsigned char ch);
+static int ssd1306_command(SSD1306PyObject *self, uint8_t c);
+static int ssd1306_commands(SSD1306PyObject *self, const uint8_t *c, int len);
+static int ssd1306_xfer(SSD1306PyObject *self, const uint8_t *buf, int len);
+static inline void ssd1306_sent(SSD1306PyObject *self, int m, const uint8_t *data, int lo, int hi);
+static inline void ssd1306_sending(SSD1306PyObject *self, int m);
+static inline void ssd1306_stale(SSD1306PyObject *self, int mask);
+static int ssd1306_setup(SSD1306PyObject *self);
+static int ssd1306_attach(SSD1306PyObject *self);
+static int ssd1306_snapshot(SSD1306PyObject *self, const char *path);
+static int ssd1306_ioCheck(SSD1306PyObject *self);
+static int ssd1306_flush(SSD1306PyObject *self);
+static int ssd1306_flushPages(SSD1306PyObject *self, int start, int end);
+static int ssd1306_flushTransposed(SSD1306PyObject *self);
+static void ssd1306_record(SSD1306PyObject *self);
+static int ssd1306_recordStop(SSD1306PyObject *self);
+static inline void transpose8(const uint8_t *in, uint8_t *out);
+static void ssd1306_dirty(CanvasPyObject *self, int x0, int y0, int x1, int y1);
+static void ssd1306_dirtyAll(CanvasPyObject *self);
+static void view_full(CanvasPyObject *self);
+static void ssd1306_viewReset(CanvasPyObject *self);
+static void ssd1306_remap(SSD1306PyObject *self);
+static void ssd1306_consoleWrite(SSD1306PyObject *self, const char *str);
+static PyObject *ssd1306_writeString(CanvasPyObject *self, PyObject *args, PyObject *kwds);
+static void ssd1306_pixel(CanvasPyObject *self, int x, int y, int color);
+static void ssd1306_plot(CanvasPyObject *self, int x, int y, int rop);
+static int *ssd1306_ints(PyObject *obj, Py_ssize_t *len);
+static PyObject *ssd1306_text(PyObject *obj);
+static void ssd1306_points(CanvasPyObject *self, const int *xs, const int *ys, Py_ssize_t n, int rop);
+static void ssd1306_trace(CanvasPyObject *self, int x0, const int *ys, Py_ssize_t n, int rop, int connect);
+static inline uint8_t page_mask(int page, int y0, int y1);
+static int ssd1306_rop(CanvasPyObject *self, int color);
+static int ssd1306_fillRop(CanvasPyObject *self, int color);
+static void ssd1306_fill(CanvasPyObject *self, int x, int y, int w, int h, int rop);
+static void ssd1306_vspan(CanvasPyObject *self, int x, int y0, int y1, int rop);
+static void ssd1306_hspan(CanvasPyObject *self, int x0, int x1, int y, int rop);
+static void ssd1306_line(CanvasPyObject *self, int x0, int y0, int x1, int y1, int rop);
+static int ssd1306_circle(CanvasPyObject *self, int x0, int y0, int r, int fill, int rop);
+static int ssd1306_ellipse(CanvasPyObject *self, int x0, int y0, int a, int b, int fill, int rop);
+static int ssd1306_roundRect(CanvasPyObject *self, int x, int y, int w, int h, int r, int fill, int rop);
+#define POLY_OUTLINE	0	// edge pixels only
+#define POLY_EVENODD	1
+#define POLY_NONZERO	2
+
+static int ssd1306_polygon(CanvasPyObject *self, const int *xs, const int *ys, Py_ssize_t n, int mode, int rop);
+static int ssd1306_arc(CanvasPyObject *self, int x0, int y0, int r, int start, int end, int fill, int rop);
+static int ssd1306_flood(CanvasPyObject *self, int x, int y, int rop);
+static void ssd1306_blit(CanvasPyObject *self, int x, int y, const uint8_t *src, int w, int h, int op);
+static void ssd1306_shift(CanvasPyObject *self, int x, int y, int w, int h, int dx, int dy, int fill);
+static void ssd1306_spriteDraw(CanvasPyObject *self, ssd1306_sprite *s, int restore);
+static void ssd1306_spriteMove(CanvasPyObject *self, int id, int x, int y, int show);
+static void ssd1306_spritesDrop(CanvasPyObject *self);
+static void ssd1306_spritesFree(CanvasPyObject *self);
+static void ssd1306_chartDraw(CanvasPyObject *self, ssd1306_chart *c, int from, int to);
+static int ssd1306_chartScale(ssd1306_chart *c);
+static void ssd1306_chartsFree(CanvasPyObject *self);
+static int ssd1306_char(CanvasPyObject *self, unsigned char ch);
+static int ssd1306_charWidth(CanvasPyObject *self, unsigned char ch);
 static void swap(int *a, int *b);
 
+// Coordinate v moved by origin o, kept in int range
+static inline
+int view_add(int v, int o) {
+	long long t = (long long)v + o;
+
+	return t > INT_MAX ? INT_MAX : t < INT_MIN ? INT_MIN : (int)t;
+}
+
+// Drawing call coordinates x, y to buffer coordinates
+#define VIEW_XY(self, x, y) \
+	do { \
+		(x) = view_add((x), (self)->view.ox); \
+		(y) = view_add((y), (self)->view.oy); \
+	} while (0)
+
+// Same for arrays of n points, ys only if xs is NULL
+static
+void view_ints(CanvasPyObject *self, int *xs, int *ys, Py_ssize_t n) {
+	Py_ssize_t i;
+
+	if (self->view.ox == 0 && self->view.oy == 0)
+		return;
+	for (i=0; i<n; i++) {
+		if (xs != NULL) xs[i] = view_add(xs[i], self->view.ox);
+		ys[i] = view_add(ys[i], self->view.oy);
+	}
+}
+
 
 static int
 ssd1306_init(SSD1306PyObject *self, PyObject *args, PyObject *kwds) {
-	int bus, address;
-	char path[I2CDEV_MAXPATH];
-	static char *kwlist[] = {"bus", "address", NULL};
+	int bus, address, rotation = 0, attach = 0, attached = 0, valid = 0, lp, m;
+	char path[I2CDEV_MAXPATH], *snapshot = NULL;
+	static char *kwlist[] = {"bus", "address", "rotation", "attach", "snapshot", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "ii|iiz", kwlist, &bus, &address, &rotation, &attach, &snapshot))
+		return -1;
 
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "ii", kwlist, &bus, &address))
+	if (self->busy) {
+		PyErr_SetString(PyExc_RuntimeError, "display is busy in a flush by another thread");
 		return -1;
+	}
+
+	// __init__() called again: let go of the previous panel
+	if (self->fd >= 0) {
+		close(self->fd);
+		self->fd = -1;
+	}
+	if (self->snapshot != NULL) {
+		munmap(self->snapshot, SNAPSHOT_SIZE);
+		self->snapshot = NULL;
+		self->shadow = NULL;
+	}
+	self->shadow_stale = 0;
+
+	if (rotation != 0 && rotation != 90 && rotation != 180 && rotation != 270) {
+		PyErr_SetString(PyExc_ValueError, "rotation must be 0, 90, 180 or 270");
+		return -1;
+	}
 
 	if (snprintf(path, I2CDEV_MAXPATH, "/dev/i2c-%d", bus) >= I2CDEV_MAXPATH) {
 		return -1;
 	}
 	
 	if ((self->fd = open(path, O_RDWR)) < 0) {
+		PyErr_SetFromErrnoWithFilename(PyExc_IOError, path);
 		return -1;
 	}
 	
+	self->stat_syscalls++;
 	if (ioctl(self->fd, I2C_SLAVE, address) < 0) {
-		return -2;
+		PyErr_SetFromErrnoWithFilename(PyExc_IOError, path);
+		return -1;
 	}
 	
-	self->width = SSD1306_WIDTH;
-	self->height = SSD1306_HEIGHT;
+	self->bus = bus;
+	self->address = address;
+	self->rotation = rotation;
+	self->width = (rotation == 90 || rotation == 270) ? SSD1306_HEIGHT : SSD1306_WIDTH;
+	self->height = (rotation == 90 || rotation == 270) ? SSD1306_WIDTH : SSD1306_HEIGHT;
+	ssd1306_viewReset(CANVAS(self));
 	self->color = 1;
 	self->bg_color = 0;
+	self->text_size = 1;
+	memset(self->pattern, 0xFF, sizeof(self->pattern));
+	self->patterned = 0;
 	self->cursor_x = 0;
 	self->cursor_y = 0;
 
 	self->font = System5x7;
 	self->char_spacing = 1;
 
-	//write command to the screen registers.
-	ssd1306_command(self, SSD1306_CMD_DISPLAY_OFF);//display off
-	ssd1306_command(self, 0x00);	//Set Memory Addressing Mode
-	ssd1306_command(self, 0x10);	//00,Horizontal Addressing Mode;01,Vertical Addressing Mode;10,Page Addressing Mode (RESET);11,Invalid
-	ssd1306_command(self, 0x40);	//Set Page Start Address for Page Addressing Mode,0-7
-	ssd1306_command(self, 0xB0);	//Set COM Output Scan Direction
-	ssd1306_command(self, 0x81);	//---set low column address
-	ssd1306_command(self, 0xCF);	//---set high column address
-	ssd1306_command(self, 0xA1);	//--set start line address
-	ssd1306_command(self, 0xA6);	//--set contrast control register
-	ssd1306_command(self, 0xA8);
-	ssd1306_command(self, 0x3F);	//--set segment re-map 0 to 127
-	ssd1306_command(self, 0xC8);	//--set normal display
-	ssd1306_command(self, 0xD3);	//--set multiplex ratio(1 to 64)
-	ssd1306_command(self, 0x00);	//
-	ssd1306_command(self, 0xD5);	//0xa4,Output follows RAM content;0xa5,Output ignores RAM content
-	ssd1306_command(self, 0x80);	//-set display offset
-	ssd1306_command(self, 0xD9);	//-not offset
-	ssd1306_command(self, 0xF1);	//--set display clock divide ratio/oscillator frequency
-	ssd1306_command(self, 0xDA);	//--set divide ratio
-	ssd1306_command(self, 0x12);	//--set pre-charge period
-	ssd1306_command(self, 0xDB);	//
-	ssd1306_command(self, 0x40);	//--set com pins hardware configuration
-	ssd1306_command(self, 0x8D);	//--set vcomh
-	ssd1306_command(self, 0x14);	//0x20,0.77xVcc
-	ssd1306_command(self, 0xAF);	//--set DC-DC enable
-	ssd1306_command(self, SSD1306_CMD_DISPLAY_ON);	//--turn on oled panel
+	if (snapshot != NULL && (valid = ssd1306_snapshot(self, snapshot)) < 0)
+		return -1;
+
+	if (attach) {
+		attached = ssd1306_attach(self);
+	}
+	if (!attached) {
+		ssd1306_setup(self);
+	}
+	if (attached != 1) {
+		valid = 0;
+	}
+	if (ssd1306_ioCheck(self) < 0)
+		return -1;
+
+	if (!valid) {
+		// panel RAM content is unknown, first update sends everything
+		ssd1306_stale(self, 0xFF);
+		ssd1306_dirtyAll(CANVAS(self));
+		return 0;
+	}
+
+	// attached to the panel the snapshot describes, buffer starts as its
+	// image and nothing is dirty
+	if (rotation == 90 || rotation == 270) {
+		for (lp=0; lp<SSD1306_MAXPAGES; lp++) {
+			for (m=0; m<SSD1306_MAXROW; m++) {
+				transpose8(&self->shadow[m * SSD1306_WIDTH + lp * 8], &self->frame[lp * SSD1306_HEIGHT + m * 8]);
+			}
+		}
+	} else {
+		memcpy(self->frame, self->shadow, SSD1306_FBSIZE);
+	}
+	// pages left unknown by the previous owner are sent whole
+	if (self->shadow_stale) {
+		ssd1306_dirtyAll(CANVAS(self));
+	}
 
 	return 0;
 }
 
-static PyObject *
-ssd1306_update(SSD1306PyObject *self, PyObject *unused) {
-	unsigned int  i = 0;
-	unsigned char m, n;
-	unsigned char tmpbuf[SSD1306_WIDTH+2];
+// Take over a panel set up by a previous owner without the init sequence
+// and its display off/on flicker. Returns 0 if the status byte says the
+// panel is off, then it needs the full setup, 1 if it is on. Panels that
+// don't answer reads are trusted to be set up, but nothing is known of
+// their RAM: returns 2.
+static int
+ssd1306_attach(SSD1306PyObject *self) {
+	uint8_t status, cmd[2];
+	int known;
 
-	for(m=0; m<8; m++) {
-		ssd1306_command(self, 0xb0+m);	// page0-page1
-		ssd1306_command(self, 0x00);	// low column start address
-		ssd1306_command(self, 0x10);	// high column start address
+	self->stat_syscalls++;
+	known = read(self->fd, &status, 1) == 1;
+	if (known && (status & SSD1306_STATUS_OFF))
+		return 0;
 
-		tmpbuf[0] = 0x40;
-		for (n=0; n<SSD1306_WIDTH; n++) {
-			tmpbuf[n+1] = self->frame[i++];
-		}
+	cmd[0] = SSD1306_CMD_SCROLL_STOP;
+	cmd[1] = SSD1306_CMD_START_LINE;
+	ssd1306_commands(self, cmd, 2);
+	ssd1306_remap(self);
+
+	return known ? 1 : 2;
+}
+
+// Map snapshot file, created if needed. Returns 1 if it holds a panel
+// image, 0 if it was new or invalid, -1 with exception on error or if it
+// belongs to another bus or address.
+static int
+ssd1306_snapshot(SSD1306PyObject *self, const char *path) {
+	int fd, valid;
+	uint8_t *map;
+
+	if ((fd = open(path, O_RDWR | O_CREAT, 0644)) < 0) {
+		PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *)path);
+		return -1;
+	}
 
-		write(self->fd, tmpbuf, SSD1306_WIDTH+1);
+	valid = lseek(fd, 0, SEEK_END) == SNAPSHOT_SIZE;
+	if (!valid && ftruncate(fd, SNAPSHOT_SIZE) < 0) {
+		PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *)path);
+		close(fd);
+		return -1;
 	}
 
-	Py_RETURN_NONE;
+	map = mmap(NULL, SNAPSHOT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		PyErr_SetFromErrnoWithFilename(PyExc_IOError, (char *)path);
+		return -1;
+	}
+
+	valid = valid && memcmp(map, SNAPSHOT_MAGIC, 8) == 0;
+	if (valid && (map[SNAPSHOT_ADDRESS] != self->address || (map[SNAPSHOT_BUS] | map[SNAPSHOT_BUS + 1] << 8) != self->bus)) {
+		munmap(map, SNAPSHOT_SIZE);
+		PyErr_SetString(PyExc_ValueError, "snapshot belongs to another display");
+		return -1;
+	}
+	if (!valid) {
+		memset(map, 0, SNAPSHOT_SIZE);
+		memcpy(map, SNAPSHOT_MAGIC, 8);
+		map[SNAPSHOT_STALE] = 0xFF;
+		map[SNAPSHOT_ADDRESS] = self->address;
+		map[SNAPSHOT_BUS] = self->bus;
+		map[SNAPSHOT_BUS + 1] = self->bus >> 8;
+	}
+
+	self->snapshot = map;
+	self->shadow = map + SNAPSHOT_HEAD;
+	self->shadow_stale = map[SNAPSHOT_STALE];
+
+	return valid;
 }
 
-static PyObject *
-ssd1306_clear(SSD1306PyObject *self, PyObject *unused) {
-	memset(self->frame, 0x00, SSD1306_FBSIZE);
+// Controller setup, sent as one command transaction
+static const uint8_t ssd1306_init_cmds[] = {
+	SSD1306_CMD_DISPLAY_OFF,
+	SSD1306_CMD_SCROLL_STOP,	// scroll may be left running by previous owner
+	0x00, 0x10,	// column address 0
+	0x40,	// start line 0
+	0xB0,	// page 0
+	0x81, 0xCF,	// contrast
+	0xA1,	// segment remap, column 127 is SEG0
+	0xA6,	// normal, not inverted display
+	0xA8, 0x3F,	// multiplex ratio 64
+	0xC8,	// COM scan COM63 to COM0
+	0xD3, 0x00,	// display offset 0
+	0xD5, 0x80,	// clock divide ratio and oscillator frequency
+	0xD9, 0xF1,	// pre-charge period
+	0xDA, 0x12,	// COM pins hardware configuration
+	0xDB, 0x40,	// VCOMH deselect level
+	0x8D, 0x14,	// charge pump on
+	SSD1306_CMD_DISPLAY_ON,
+};
 
-	ssd1306_update(self, NULL);
+// Bring controller to the state of this object: init sequence, remap,
+// console start line. Scrolling is stopped by it.
+static int
+ssd1306_setup(SSD1306PyObject *self) {
+	if (ssd1306_commands(self, ssd1306_init_cmds, sizeof(ssd1306_init_cmds)) < 0)
+		return -1;
+	self->scrolling = 0;
 
-	Py_RETURN_NONE;
+	if (self->rotation || self->mirror_x || self->mirror_y) {
+		ssd1306_remap(self);
+	}
+
+	if (self->console_start) {
+		ssd1306_command(self, SSD1306_CMD_START_LINE | (self->console_start * 8));
+	}
+
+	return self->io_errno ? -1 : 0;
 }
 
-static PyObject *
-ssd1306_drawPixel(SSD1306PyObject *self, PyObject *args) {
-	int x, y, color;
+// Raise IOError for the first failed bus write since the last check, or
+// for the stream write that stopped recording
+static int
+ssd1306_ioCheck(SSD1306PyObject *self) {
+	char path[I2CDEV_MAXPATH];
 
-	if (!PyArg_ParseTuple(args, "iii", &x, &y, &color)) {
-		return NULL;
+	if (self->io_errno == 0) {
+		if (self->rec_errno == 0)
+			return 0;
+		// recording stopped on a failed stream write
+		errno = self->rec_errno;
+		self->rec_errno = 0;
+		PyErr_SetFromErrno(PyExc_IOError);
+		return -1;
 	}
 
-	ssd1306_pixel(self, x, y, color);
+	snprintf(path, I2CDEV_MAXPATH, "/dev/i2c-%d", self->bus);
+	errno = self->io_errno;
+	self->io_errno = 0;
+	PyErr_SetFromErrnoWithFilename(PyExc_IOError, path);
 
-	Py_RETURN_NONE;
+	return -1;
 }
 
-// Bresenham's algorithm - thx wikpedia
 static PyObject *
-ssd1306_drawLine(SSD1306PyObject *self, PyObject *args) {
-	int x0, y0, x1, y1, color;
-	
-	if (!PyArg_ParseTuple(args, "iiiii", &x0, &y0, &x1, &y1, &color)) {
-		return NULL;
-	}
-	
-	int16_t steep = abs(y1 - y0) > abs(x1 - x0);
+ssd1306_new(PyTypeObject *type, PyObject *args, PyObject *kwds) {
+	SSD1306PyObject *self = (SSD1306PyObject *)type->tp_alloc(type, 0);
 
-	if (steep) {
-		swap(&x0, &y0);
-		swap(&x1, &y1);
+	if (self != NULL) {
+		self->fd = -1;
+		self->frame = self->fb;
+		self->dirty_lo = self->page_lo;
+		self->dirty_hi = self->page_hi;
 	}
 
-	if (x0 > x1) {
-		swap(&x0, &x1);
-		swap(&y0, &y1);
+	return (PyObject *)self;
+}
+
+static void
+ssd1306_dealloc(SSD1306PyObject *self) {
+	ssd1306_spritesFree(CANVAS(self));
+	ssd1306_chartsFree(CANVAS(self));
+	free(self->scrollback);
+	ssd1306_recordStop(self);
+	if (self->snapshot != NULL) {
+		munmap(self->snapshot, SNAPSHOT_SIZE);
 	}
+	if (self->fd >= 0) {
+		close(self->fd);
+	}
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
 
-	int16_t dx, dy;
-	dx = x1 - x0;
-	dy = abs(y1 - y0);
+static PyObject *
+ssd1306_update(SSD1306PyObject *self, PyObject *args, PyObject *kwds) {
+	int full = 0;
+	static char *kwlist[] = {"full", NULL};
 
-	int16_t err = dx / 2;
-	int16_t ystep;
+	BUSY_CHECK(self);
 
-	if (y0 < y1) {
-		ystep = 1;
-	} else {
-		ystep = -1;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", kwlist, &full)) {
+		return NULL;
 	}
 
-	for (; x0<=x1; x0++) {
-		if (steep) {
-			ssd1306_pixel(self, y0, x0, color);
-		} else {
-			ssd1306_pixel(self, x0, y0, color);
-		}
-		err -= dy;
-		if (err < 0) {
-			y0 += ystep;
-			err += dx;
-		}
+	if (full) {
+		ssd1306_stale(self, 0xFF);
+		ssd1306_dirtyAll(CANVAS(self));
 	}
 
+	ssd1306_flush(self);
+	if (ssd1306_ioCheck(self) < 0)
+		return NULL;
+
 	Py_RETURN_NONE;
 }
 
 static PyObject *
-ssd1306_drawFastVLine(SSD1306PyObject *self, PyObject *args) {
-	int x, y, len, color;
-    PyObject *pArgs;
-	
-	if (!PyArg_ParseTuple(args, "iiii", &x, &y, &len, &color)) {
+ssd1306_reinit(SSD1306PyObject *self, PyObject *unused) {
+	BUSY_CHECK(self);
+
+	ssd1306_setup(self);
+	ssd1306_stale(self, 0xFF);
+	ssd1306_dirtyAll(CANVAS(self));
+	ssd1306_flush(self);
+	if (ssd1306_ioCheck(self) < 0)
 		return NULL;
-	}
 
-	pArgs = Py_BuildValue("iiiii", x, y, x, y+len-1, color);
-	ssd1306_drawLine(self, pArgs);
-	
 	Py_RETURN_NONE;
 }
 
 static PyObject *
-ssd1306_drawFastHLine(SSD1306PyObject *self, PyObject *args) {
-	int x, y, len, color;
-    PyObject *pArgs;
-	
-	if (!PyArg_ParseTuple(args, "iiii", &x, &y, &len, &color)) {
+ssd1306_clear(SSD1306PyObject *self, PyObject *unused) {
+	BUSY_CHECK(self);
+
+	memset(self->frame, 0x00, SSD1306_FBSIZE);
+	ssd1306_spritesDrop(CANVAS(self));
+	ssd1306_dirtyAll(CANVAS(self));
+
+	ssd1306_flush(self);
+	if (ssd1306_ioCheck(self) < 0)
 		return NULL;
-	}
 
-	pArgs = Py_BuildValue("iiiii", x, y, x+len-1, y, color);
-	ssd1306_drawLine(self, pArgs);
-	
 	Py_RETURN_NONE;
 }
 
+static int
+canvas_init(CanvasPyObject *self, PyObject *args, PyObject *kwds) {
+	int width, height, pages, i;
+	unsigned char *frame;
+	int *dirty_lo, *dirty_hi;
+	static char *kwlist[] = {"width", "height", NULL};
 
-static PyObject *
-ssd1306_drawRect(SSD1306PyObject *self, PyObject *args) {
-	int i;
-	int x, y, w, h, color;
-    PyObject *pArgs;
+	// SSD1306 buffer is inline in the object, not a heap block to replace
+	if (PyObject_TypeCheck((PyObject *)self, &SSD1306ObjectType)) {
+		PyErr_SetString(PyExc_TypeError, "Canvas.__init__() needs a Canvas");
+		return -1;
+	}
 
-	if (!PyArg_ParseTuple(args, "iiiii", &x, &y, &w, &h, &color)) {
-		return NULL;
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "ii", kwlist, &width, &height))
+		return -1;
+
+	if (width < 1 || height < 1 || width > 4096 || height > 4096) {
+		PyErr_SetString(PyExc_ValueError, "canvas size must be 1-4096 pixels");
+		return -1;
 	}
 
-	pArgs = Py_BuildValue("iiii", x, y, w, color);
-	ssd1306_drawFastHLine(self, pArgs);
+	pages = (height + 7) / 8;
 
-	pArgs = Py_BuildValue("iiii", x, y+h-1, w, color);
-	ssd1306_drawFastHLine(self, pArgs);
+	// a failed allocation leaves a reinitialized canvas as it was
+	frame = calloc(pages, width);
+	dirty_lo = malloc(pages * sizeof(int));
+	dirty_hi = malloc(pages * sizeof(int));
+	if (frame == NULL || dirty_lo == NULL || dirty_hi == NULL) {
+		free(frame);
+		free(dirty_lo);
+		free(dirty_hi);
+		PyErr_NoMemory();
+		return -1;
+	}
 
-	pArgs = Py_BuildValue("iiii", x, y, h, color);
-	ssd1306_drawFastVLine(self, pArgs);
+	for (i=0; i<pages; i++) {
+		dirty_lo[i] = width;
+		dirty_hi[i] = -1;
+	}
 
-	pArgs = Py_BuildValue("iiii", x+w-1, y, h, color);
-	ssd1306_drawFastVLine(self, pArgs);
-	
-	Py_RETURN_NONE;
+	ssd1306_spritesFree(self);
+	ssd1306_chartsFree(self);
+	free(self->frame);
+	free(self->dirty_lo);
+	free(self->dirty_hi);
+	self->frame = frame;
+	self->dirty_lo = dirty_lo;
+	self->dirty_hi = dirty_hi;
+
+	self->width = width;
+	self->height = height;
+	ssd1306_viewReset(self);
+	self->color = 1;
+	self->bg_color = 0;
+	self->text_size = 1;
+	memset(self->pattern, 0xFF, sizeof(self->pattern));
+	self->patterned = 0;
+	self->cursor_x = 0;
+	self->cursor_y = 0;
+
+	self->font = System5x7;
+	self->char_spacing = 1;
+
+	return 0;
+}
+
+static void
+canvas_dealloc(CanvasPyObject *self) {
+	ssd1306_spritesFree(self);
+	ssd1306_chartsFree(self);
+	free(self->frame);
+	free(self->dirty_lo);
+	free(self->dirty_hi);
+	Py_TYPE(self)->tp_free((PyObject *)self);
 }
 
 static PyObject *
-ssd1306_fillRect(SSD1306PyObject *self, PyObject *args) {
-	int i;
-	int x, y, w, h, color;
-    PyObject *pArgs;
+canvas_clear(CanvasPyObject *self, PyObject *unused) {
+	BUSY_CHECK(self);
 
-	if (!PyArg_ParseTuple(args, "iiiii", &x, &y, &w, &h, &color)) {
+	memset(self->frame, 0x00, self->width * ((self->height + 7) / 8));
+	ssd1306_spritesDrop(self);
+	ssd1306_dirtyAll(self);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+canvas_push(CanvasPyObject *self, PyObject *unused) {
+	if (self->view_depth == VIEW_DEPTH) {
+		PyErr_SetString(PyExc_IndexError, "view stack full");
 		return NULL;
 	}
 
-	// Update in subclasses if desired!
-	for (i=x; i<x+w; i++) {
-		pArgs = Py_BuildValue("iiii", i, y, h, color);
-		ssd1306_drawFastVLine(self, pArgs);
-	}
+	self->views[self->view_depth++] = self->view;
 
 	Py_RETURN_NONE;
 }
 
 static PyObject *
-ssd1306_drawCircle(SSD1306PyObject *self, PyObject *args) {
-	int x0, y0, r, color;
-
-	if (!PyArg_ParseTuple(args, "iiii", &x0, &y0, &r, &color)) {
+canvas_pop(CanvasPyObject *self, PyObject *unused) {
+	if (self->view_depth == 0) {
+		PyErr_SetString(PyExc_IndexError, "pop without push");
 		return NULL;
 	}
-	
-	int16_t f = 1 - r;
-	int16_t ddF_x = 1;
-	int16_t ddF_y = -2 * r;
-	int16_t x = 0;
-	int16_t y = r;
 
-	ssd1306_pixel(self, x0, y0+r, color);
-	ssd1306_pixel(self, x0, y0-r, color);
-	ssd1306_pixel(self, x0+r, y0, color);
-	ssd1306_pixel(self, x0-r, y0, color);
+	self->view = self->views[--self->view_depth];
 
-	while (x < y) {
-		if (f >= 0) {
-			y--;
-			ddF_y += 2;
-			f += ddF_y;
-		}
-		x++;
-		ddF_x += 2;
-		f += ddF_x;
+	Py_RETURN_NONE;
+}
 
-		ssd1306_pixel(self, x0 + x, y0 + y, color);
-		ssd1306_pixel(self, x0 - x, y0 + y, color);
-		ssd1306_pixel(self, x0 + x, y0 - y, color);
-		ssd1306_pixel(self, x0 - x, y0 - y, color);
-		ssd1306_pixel(self, x0 + y, y0 + x, color);
-		ssd1306_pixel(self, x0 - y, y0 + x, color);
-		ssd1306_pixel(self, x0 + y, y0 - x, color);
-		ssd1306_pixel(self, x0 - y, y0 - x, color);
+static PyObject *
+canvas_translate(CanvasPyObject *self, PyObject *args) {
+	int dx, dy;
+
+	if (!PyArg_ParseTuple(args, "ii", &dx, &dy)) {
+		return NULL;
 	}
 
+	VIEW_XY(self, dx, dy);
+	self->view.ox = dx;
+	self->view.oy = dy;
+
 	Py_RETURN_NONE;
 }
 
 static PyObject *
-ssd1306_setCursor(SSD1306PyObject *self, PyObject *args) {
-	int x, y;
-	
-	if (!PyArg_ParseTuple(args, "ii", &x, &y)) {
+canvas_clip(CanvasPyObject *self, PyObject *args) {
+	int x, y, w, h;
+	long long x1, y1;
+	ssd1306_view *v = &self->view;
+
+	if (!PyArg_ParseTuple(args, "iiii", &x, &y, &w, &h)) {
 		return NULL;
 	}
 
-	self->cursor_x = x;
-	self->cursor_y = y;
+	x1 = (long long)x + v->ox + w - 1;
+	y1 = (long long)y + v->oy + h - 1;
+	VIEW_XY(self, x, y);
+
+	if (x < v->x0) x = v->x0;
+	if (y < v->y0) y = v->y0;
+	if (x1 > v->x1) x1 = v->x1;
+	if (y1 > v->y1) y1 = v->y1;
+
+	if (x > x1 || y > y1) {
+		// nothing left, an empty rect inside the buffer
+		v->x0 = v->y0 = 0;
+		v->x1 = v->y1 = -1;
+	} else {
+		v->x0 = x;
+		v->y0 = y;
+		v->x1 = (int)x1;
+		v->y1 = (int)y1;
+	}
 
 	Py_RETURN_NONE;
 }
 
 static PyObject *
-ssd1306_setFont(SSD1306PyObject *self, PyObject *args, PyObject *kwds) {
-	int i, spacing = 1;
-	unsigned char *font;
-	font_info *f = fonts_table;
-	static char *kwlist[] = {"font", "spacing", NULL};
+canvas_blit(CanvasPyObject *self, PyObject *args, PyObject *kwds) {
+	int x = 0, y = 0, op, size;
+	char *opname = "copy";
+	CanvasPyObject *src;
+	uint8_t *data;
+	static char *kwlist[] = {"src", "x", "y", "op", NULL};
 
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|i",  kwlist, &font, &spacing)) {
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!|iis", kwlist, &CanvasObjectType, &src, &x, &y, &opname)) {
 		return NULL;
 	}
-	
-	self->char_spacing = spacing;
 
-	while (f->name != NULL) {
-		if (strcmp(f->name, font) == 0) {
-			self->font = f->data;
-			break;
+	if (strcmp(opname, "copy") == 0) {
+		op = BLIT_COPY;
+	} else if (strcmp(opname, "or") == 0) {
+		op = BLIT_OR;
+	} else if (strcmp(opname, "and") == 0) {
+		op = BLIT_AND;
+	} else if (strcmp(opname, "xor") == 0) {
+		op = BLIT_XOR;
+	} else {
+		PyErr_SetString(PyExc_ValueError, "op must be 'copy', 'or', 'and' or 'xor'");
+		return NULL;
+	}
+
+	if (src->frame == NULL)
+		Py_RETURN_NONE;
+
+	VIEW_XY(self, x, y);
+
+	PRIM_ENTRY(self, PRIM_BLIT);
+
+	if (src != self) {
+		ssd1306_blit(self, x, y, src->frame, src->width, src->height, op);
+		PRIM_EXIT(self, PRIM_BLIT);
+		Py_RETURN_NONE;
+	}
+
+	// source and destination overlap
+	size = src->width * ((src->height + 7) / 8);
+	if ((data = malloc(size)) == NULL) {
+		PRIM_EXIT(self, PRIM_BLIT);
+		return PyErr_NoMemory();
+	}
+	memcpy(data, src->frame, size);
+	ssd1306_blit(self, x, y, data, src->width, src->height, op);
+	free(data);
+
+	PRIM_EXIT(self, PRIM_BLIT);
+	Py_RETURN_NONE;
+}
+
+static ssd1306_sprite *
+sprite_get(CanvasPyObject *self, int id) {
+	if (id < 0 || id >= self->sprite_count || self->sprites[id].data == NULL) {
+		PyErr_SetString(PyExc_ValueError, "no such sprite");
+		return NULL;
+	}
+
+	return &self->sprites[id];
+}
+
+static PyObject *
+canvas_spriteAdd(CanvasPyObject *self, PyObject *args, PyObject *kwds) {
+	int id, k, c, r, w, h, pages, size;
+	CanvasPyObject *image, *mask = NULL;
+	PyObject *maskobj = Py_None;
+	ssd1306_sprite *s;
+	uint8_t *img, *msk, m, v, prev_v, prev_m;
+	static char *kwlist[] = {"image", "mask", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!|O", kwlist, &CanvasObjectType, &image, &maskobj)) {
+		return NULL;
+	}
+
+	if (maskobj != Py_None) {
+		if (!PyObject_TypeCheck(maskobj, &CanvasObjectType)) {
+			PyErr_SetString(PyExc_TypeError, "mask must be a Canvas or None");
+			return NULL;
+		}
+		mask = CANVAS(maskobj);
+		if (mask->width != image->width || mask->height != image->height) {
+			PyErr_SetString(PyExc_ValueError, "mask must have the size of image");
+			return NULL;
+		}
+	}
+
+	if (image->frame == NULL || (mask != NULL && mask->frame == NULL)) {
+		PyErr_SetString(PyExc_ValueError, "canvas is not initialized");
+		return NULL;
+	}
+
+	// reuse slot of a removed sprite
+	for (id=0; id<self->sprite_count; id++) {
+		if (self->sprites[id].data == NULL)
+			break;
+	}
+
+	if (id == self->sprite_count) {
+		s = realloc(self->sprites, (self->sprite_count + 1) * sizeof(ssd1306_sprite));
+		if (s == NULL) {
+			return PyErr_NoMemory();
+		}
+		self->sprites = s;
+		self->sprite_count++;
+	}
+
+	w = image->width;
+	h = image->height;
+	pages = (h + 14) / 8;	// rows r..r+h-1, r up to 7
+	size = pages * w;
+
+	s = &self->sprites[id];
+	memset(s, 0, sizeof(ssd1306_sprite));
+	s->data = malloc(16 * size);
+	s->save = malloc(size);
+	if (s->data == NULL || s->save == NULL) {
+		free(s->data);
+		free(s->save);
+		s->data = NULL;
+		return PyErr_NoMemory();
+	}
+	s->w = w;
+	s->h = h;
+	s->pages = pages;
+
+	for (r=0; r<8; r++) {
+		img = s->data + r * size;
+		msk = s->data + (8 + r) * size;
+
+		for (c=0; c<w; c++) {
+			prev_v = prev_m = 0;
+			for (k=0; k<pages; k++) {
+				// unshifted page k, rows outside image are transparent
+				m = k * 8 < h ? page_mask(k, 0, h - 1) : 0;
+				if (m && mask != NULL) m &= mask->frame[k * w + c];
+				v = m ? image->frame[k * w + c] & m : 0;
+
+				img[k * w + c] = (v << r) | (r ? prev_v >> (8 - r) : 0);
+				msk[k * w + c] = (m << r) | (r ? prev_m >> (8 - r) : 0);
+				prev_v = v;
+				prev_m = m;
+			}
+		}
+	}
+
+	return PyInt_FromLong(id);
+}
+
+static PyObject *
+canvas_spriteMove(CanvasPyObject *self, PyObject *args) {
+	int id, x, y;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iii", &id, &x, &y)) {
+		return NULL;
+	}
+
+	if (sprite_get(self, id) == NULL)
+		return NULL;
+
+	VIEW_XY(self, x, y);
+
+	PRIM_ENTRY(self, PRIM_SPRITE);
+	ssd1306_spriteMove(self, id, x, y, 1);
+	PRIM_EXIT(self, PRIM_SPRITE);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+canvas_spriteHide(CanvasPyObject *self, PyObject *args) {
+	int id;
+	ssd1306_sprite *s;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "i", &id)) {
+		return NULL;
+	}
+
+	if ((s = sprite_get(self, id)) == NULL)
+		return NULL;
+
+	if (s->visible) {
+		ssd1306_spriteMove(self, id, s->x, s->y, 0);
+	}
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+canvas_spriteRemove(CanvasPyObject *self, PyObject *args) {
+	int id;
+	ssd1306_sprite *s;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "i", &id)) {
+		return NULL;
+	}
+
+	if ((s = sprite_get(self, id)) == NULL)
+		return NULL;
+
+	if (s->visible) {
+		ssd1306_spriteMove(self, id, s->x, s->y, 0);
+	}
+	free(s->data);
+	free(s->save);
+	s->data = NULL;
+	s->save = NULL;
+
+	Py_RETURN_NONE;
+}
+
+static ssd1306_chart *
+chart_get(CanvasPyObject *self, int id) {
+	if (id < 0 || id >= self->chart_count || self->charts[id].lo == NULL) {
+		PyErr_SetString(PyExc_ValueError, "no such chart");
+		return NULL;
+	}
+
+	return &self->charts[id];
+}
+
+// Part of the chart rect inside its clip rect, 0 if none
+static inline
+int chart_clip(ssd1306_chart *c, int *x0, int *y0, int *x1, int *y1) {
+	*x0 = c->x < c->x0 ? c->x0 : c->x;
+	*y0 = c->y < c->y0 ? c->y0 : c->y;
+	*x1 = c->x + c->w - 1 > c->x1 ? c->x1 : c->x + c->w - 1;
+	*y1 = c->y + c->h - 1 > c->y1 ? c->y1 : c->y + c->h - 1;
+
+	return *x0 <= *x1 && *y0 <= *y1;
+}
+
+static PyObject *
+canvas_chartAdd(CanvasPyObject *self, PyObject *args, PyObject *kwds) {
+	int id, x, y, w, h, vmin = 0, vmax = 0, color = 1, style;
+	char *name = "line";
+	ssd1306_chart *c;
+	static char *kwlist[] = {"x", "y", "w", "h", "style", "min", "max", "color", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "iiii|siii", kwlist, &x, &y, &w, &h, &name, &vmin, &vmax, &color)) {
+		return NULL;
+	}
+
+	if (strcmp(name, "line") == 0) {
+		style = CHART_LINE;
+	} else if (strcmp(name, "bar") == 0) {
+		style = CHART_BAR;
+	} else if (strcmp(name, "band") == 0) {
+		style = CHART_BAND;
+	} else {
+		PyErr_SetString(PyExc_ValueError, "style must be 'line', 'bar' or 'band'");
+		return NULL;
+	}
+
+	VIEW_XY(self, x, y);
+	if (w < 1 || h < 1 || x < 0 || y < 0 || x > self->width - w || y > self->height - h) {
+		PyErr_SetString(PyExc_ValueError, "chart must lie inside the buffer");
+		return NULL;
+	}
+
+	// reuse slot of a removed chart
+	for (id=0; id<self->chart_count; id++) {
+		if (self->charts[id].lo == NULL)
+			break;
+	}
+
+	if (id == self->chart_count) {
+		c = realloc(self->charts, (self->chart_count + 1) * sizeof(ssd1306_chart));
+		if (c == NULL) {
+			return PyErr_NoMemory();
+		}
+		self->charts = c;
+		self->chart_count++;
+	}
+
+	c = &self->charts[id];
+	memset(c, 0, sizeof(ssd1306_chart));
+	c->lo = malloc(2 * w * sizeof(int));
+	if (c->lo == NULL) {
+		return PyErr_NoMemory();
+	}
+	c->hi = c->lo + w;
+	c->x = x;
+	c->y = y;
+	c->w = w;
+	c->h = h;
+	c->x0 = self->view.x0;
+	c->y0 = self->view.y0;
+	c->x1 = self->view.x1;
+	c->y1 = self->view.y1;
+	c->style = style;
+	c->color = color;
+	c->fixed = vmax > vmin;
+	c->vmin = vmin;
+	c->vmax = c->fixed ? vmax : vmin + 1;
+
+	PRIM_ENTRY(self, PRIM_CHART);
+
+	ssd1306_chartDraw(self, c, 0, c->w - 1);
+	PRIM_EXIT(self, PRIM_CHART);
+
+	return PyInt_FromLong(id);
+}
+
+static PyObject *
+canvas_chartAppend(CanvasPyObject *self, PyObject *args, PyObject *kwds) {
+	int id, i, k, n, x0, y0, x1, y1, *lo = NULL, *hi = NULL;
+	long long v;
+	PyObject *value, *high = Py_None;
+	ssd1306_chart *c;
+	Py_ssize_t nlo, nhi;
+	static char *kwlist[] = {"id", "value", "high", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "iO|O", kwlist, &id, &value, &high)) {
+		return NULL;
+	}
+
+	if ((c = chart_get(self, id)) == NULL)
+		return NULL;
+
+	// one value or an integer array of them
+	if (PyObject_CheckBuffer(value) || PySequence_Check(value)) {
+		if ((lo = ssd1306_ints(value, &nlo)) == NULL)
+			return NULL;
+		if (high != Py_None) {
+			if ((hi = ssd1306_ints(high, &nhi)) == NULL) {
+				free(lo);
+				return NULL;
+			}
+			if (nhi != nlo) {
+				free(lo);
+				free(hi);
+				PyErr_SetString(PyExc_ValueError, "value and high must have the same length");
+				return NULL;
+			}
+		}
+	} else {
+		nlo = 1;
+		lo = malloc(2 * sizeof(int));
+		if (lo == NULL)
+			return PyErr_NoMemory();
+		if ((v = PyLong_AsLongLong(value)) == -1 && PyErr_Occurred()) {
+			free(lo);
+			return NULL;
+		}
+		lo[0] = v < INT_MIN ? INT_MIN : v > INT_MAX ? INT_MAX : (int)v;
+		if (high != Py_None) {
+			hi = lo + 1;
+			if ((v = PyLong_AsLongLong(high)) == -1 && PyErr_Occurred()) {
+				free(lo);
+				return NULL;
+			}
+			hi[0] = v < INT_MIN ? INT_MIN : v > INT_MAX ? INT_MAX : (int)v;
+		}
+	}
+
+	PRIM_ENTRY(self, PRIM_CHART);
+
+	// only the last w samples can show
+	i = nlo > c->w ? nlo - c->w : 0;
+	n = nlo - i;
+	for (; i<nlo; i++) {
+		if (c->count < c->w) {
+			k = (c->head + c->count++) % c->w;
+		} else {
+			k = c->head;
+			c->head = (c->head + 1) % c->w;
+		}
+		c->lo[k] = lo[i];
+		c->hi[k] = hi != NULL ? hi[i] : lo[i];
+		if (c->lo[k] > c->hi[k])
+			swap(&c->lo[k], &c->hi[k]);
+	}
+
+	if (!c->fixed && ssd1306_chartScale(c)) {
+		ssd1306_chartDraw(self, c, 0, c->w - 1);
+	} else {
+		// move the shown part of the plot left and draw the columns
+		// moved in; the oldest line column lost the sample it was joined
+		// to, redraw it alone
+		if (chart_clip(c, &x0, &y0, &x1, &y1)) {
+			ssd1306_shift(self, x0, y0, x1 - x0 + 1, y1 - y0 + 1, -n, 0, !c->color);
+			ssd1306_chartDraw(self, c, x1 - c->x - n + 1, c->w - 1);
+			if (c->style == CHART_LINE && c->count == c->w)
+				ssd1306_chartDraw(self, c, 0, 0);
+		}
+	}
+	PRIM_EXIT(self, PRIM_CHART);
+
+	if (hi != lo + 1)
+		free(hi);
+	free(lo);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+canvas_chartDraw(CanvasPyObject *self, PyObject *args) {
+	int id;
+	ssd1306_chart *c;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "i", &id)) {
+		return NULL;
+	}
+
+	if ((c = chart_get(self, id)) == NULL)
+		return NULL;
+
+	PRIM_ENTRY(self, PRIM_CHART);
+
+	ssd1306_chartDraw(self, c, 0, c->w - 1);
+	PRIM_EXIT(self, PRIM_CHART);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+canvas_chartRemove(CanvasPyObject *self, PyObject *args) {
+	int id;
+	ssd1306_chart *c;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "i", &id)) {
+		return NULL;
+	}
+
+	if ((c = chart_get(self, id)) == NULL)
+		return NULL;
+
+	free(c->lo);
+	c->lo = c->hi = NULL;
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_drawPixel(CanvasPyObject *self, PyObject *args) {
+	int x, y, color;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iii", &x, &y, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x, y);
+
+	PRIM_ENTRY(self, PRIM_PIXEL);
+
+	ssd1306_pixel(self, x, y, color);
+	PRIM_EXIT(self, PRIM_PIXEL);
+
+	Py_RETURN_NONE;
+}
+
+// Integer array argument as C ints: 1-d buffer of integer items
+// (array.array, bytes, numpy array, ...) or any sequence of ints.
+// Values are clamped to int range. Returns malloc()ed array or NULL.
+#define INTS_LOAD(type) \
+	for (i=0; i<n; i++) { \
+		type t; \
+		memcpy(&t, p + i * stride, sizeof(t)); \
+		v = (long long)t; \
+		a[i] = v < INT_MIN ? INT_MIN : v > INT_MAX ? INT_MAX : (int)v; \
+	} \
+	break
+
+static int *
+ssd1306_ints(PyObject *obj, Py_ssize_t *len) {
+	Py_buffer view;
+	PyObject *seq;
+	const char *p, *fmt;
+	Py_ssize_t i, n, stride;
+	long long v;
+	int *a;
+
+	if (PyObject_CheckBuffer(obj)) {
+		if (PyObject_GetBuffer(obj, &view, PyBUF_FORMAT | PyBUF_STRIDES) < 0)
+			return NULL;
+
+		fmt = view.format != NULL ? view.format : "B";
+		if (*fmt == '@')
+			fmt++;
+		if (view.ndim != 1 || fmt[0] == 0 || fmt[1] != 0 || strchr("bBhHiIlLqQnN", fmt[0]) == NULL) {
+			PyBuffer_Release(&view);
+			PyErr_SetString(PyExc_TypeError, "integer array expected");
+			return NULL;
+		}
+
+		n = view.shape != NULL ? view.shape[0] : view.len / view.itemsize;
+		stride = view.strides != NULL ? view.strides[0] : view.itemsize;
+		p = view.buf;
+		if ((a = malloc((n + 1) * sizeof(*a))) == NULL) {
+			PyBuffer_Release(&view);
+			PyErr_NoMemory();
+			return NULL;
+		}
+
+		switch (fmt[0]) {
+		case 'b':	INTS_LOAD(signed char);
+		case 'B':	INTS_LOAD(unsigned char);
+		case 'h':	INTS_LOAD(short);
+		case 'H':	INTS_LOAD(unsigned short);
+		case 'i':	INTS_LOAD(int);
+		case 'I':	INTS_LOAD(unsigned int);
+		case 'l':	INTS_LOAD(long);
+		case 'L':	INTS_LOAD(unsigned long);
+		case 'q':	INTS_LOAD(long long);
+		case 'Q':	INTS_LOAD(unsigned long long);
+		case 'n':	INTS_LOAD(Py_ssize_t);
+		case 'N':	INTS_LOAD(size_t);
+		}
+
+		PyBuffer_Release(&view);
+		*len = n;
+		return a;
+	}
+
+	if ((seq = PySequence_Fast(obj, "integer array or sequence expected")) == NULL)
+		return NULL;
+
+	n = PySequence_Fast_GET_SIZE(seq);
+	if ((a = malloc((n + 1) * sizeof(*a))) == NULL) {
+		Py_DECREF(seq);
+		PyErr_NoMemory();
+		return NULL;
+	}
+	for (i=0; i<n; i++) {
+		v = PyLong_AsLongLong(PySequence_Fast_GET_ITEM(seq, i));
+		if (v == -1 && PyErr_Occurred()) {
+			Py_DECREF(seq);
+			free(a);
+			return NULL;
+		}
+		a[i] = v < INT_MIN ? INT_MIN : v > INT_MAX ? INT_MAX : (int)v;
+	}
+
+	Py_DECREF(seq);
+	*len = n;
+	return a;
+}
+
+static PyObject *
+ssd1306_drawPixels(CanvasPyObject *self, PyObject *args, PyObject *kwds) {
+	PyObject *xo, *yo;
+	int color, *xs, *ys;
+	Py_ssize_t n, ny;
+	static char *kwlist[] = {"xs", "ys", "color", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOi", kwlist, &xo, &yo, &color)) {
+		return NULL;
+	}
+
+	if ((xs = ssd1306_ints(xo, &n)) == NULL)
+		return NULL;
+	if ((ys = ssd1306_ints(yo, &ny)) == NULL) {
+		free(xs);
+		return NULL;
+	}
+	if (n != ny) {
+		free(xs);
+		free(ys);
+		PyErr_SetString(PyExc_ValueError, "xs and ys must have the same length");
+		return NULL;
+	}
+
+	view_ints(self, xs, ys, n);
+
+	PRIM_ENTRY(self, PRIM_PIXELS);
+
+	ssd1306_points(self, xs, ys, n, ssd1306_rop(self, color));
+	PRIM_EXIT(self, PRIM_PIXELS);
+
+	free(xs);
+	free(ys);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_drawPlot(CanvasPyObject *self, PyObject *args, PyObject *kwds) {
+	PyObject *yo;
+	int x0 = 0, color = 1, connect = 0, *ys;
+	Py_ssize_t n;
+	static char *kwlist[] = {"ys", "x0", "color", "connect", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|iii", kwlist, &yo, &x0, &color, &connect)) {
+		return NULL;
+	}
+
+	if ((ys = ssd1306_ints(yo, &n)) == NULL)
+		return NULL;
+
+	x0 = view_add(x0, self->view.ox);
+	view_ints(self, NULL, ys, n);
+
+	PRIM_ENTRY(self, PRIM_PLOT);
+
+	ssd1306_trace(self, x0, ys, n, ssd1306_rop(self, color), connect);
+	PRIM_EXIT(self, PRIM_PLOT);
+
+	free(ys);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_drawLine(CanvasPyObject *self, PyObject *args) {
+	int x0, y0, x1, y1, color;
+	
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iiiii", &x0, &y0, &x1, &y1, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x0, y0);
+	VIEW_XY(self, x1, y1);
+
+	PRIM_ENTRY(self, PRIM_LINE);
+
+	ssd1306_line(self, x0, y0, x1, y1, ssd1306_rop(self, color));
+	PRIM_EXIT(self, PRIM_LINE);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_drawFastVLine(CanvasPyObject *self, PyObject *args) {
+	int x, y, len, color;
+	
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iiii", &x, &y, &len, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x, y);
+
+	PRIM_ENTRY(self, PRIM_LINE);
+
+	ssd1306_line(self, x, y, x, y+len-1, ssd1306_rop(self, color));
+	PRIM_EXIT(self, PRIM_LINE);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_drawFastHLine(CanvasPyObject *self, PyObject *args) {
+	int x, y, len, color;
+	
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iiii", &x, &y, &len, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x, y);
+
+	PRIM_ENTRY(self, PRIM_LINE);
+
+	ssd1306_line(self, x, y, x+len-1, y, ssd1306_rop(self, color));
+	PRIM_EXIT(self, PRIM_LINE);
+
+	Py_RETURN_NONE;
+}
+
+
+static PyObject *
+ssd1306_drawRect(CanvasPyObject *self, PyObject *args) {
+	int x, y, w, h, color, rop;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iiiii", &x, &y, &w, &h, &color)) {
+		return NULL;
+	}
+
+	if (w < 1 || h < 1)
+		Py_RETURN_NONE;
+
+	VIEW_XY(self, x, y);
+
+	PRIM_ENTRY(self, PRIM_RECT);
+
+	// edges don't overlap, so XOR twice restores corners too
+	rop = ssd1306_rop(self, color);
+	ssd1306_hspan(self, x, x+w-1, y, rop);
+	if (h > 1) {
+		ssd1306_hspan(self, x, x+w-1, y+h-1, rop);
+	}
+	if (h > 2) {
+		ssd1306_vspan(self, x, y+1, y+h-2, rop);
+		if (w > 1) {
+			ssd1306_vspan(self, x+w-1, y+1, y+h-2, rop);
+		}
+	}
+	PRIM_EXIT(self, PRIM_RECT);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_fillRect(CanvasPyObject *self, PyObject *args) {
+	int x, y, w, h, color;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iiiii", &x, &y, &w, &h, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x, y);
+
+	PRIM_ENTRY(self, PRIM_RECT_FILL);
+
+	ssd1306_fill(self, x, y, w, h, ssd1306_fillRop(self, color));
+	PRIM_EXIT(self, PRIM_RECT_FILL);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_scrollRegion(CanvasPyObject *self, PyObject *args, PyObject *kwds) {
+	int x, y, w, h, dx, dy, fill = 0;
+	long long x1, y1;
+	static char *kwlist[] = {"x", "y", "w", "h", "dx", "dy", "fill", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "iiiiii|i", kwlist, &x, &y, &w, &h, &dx, &dy, &fill)) {
+		return NULL;
+	}
+
+	// region in buffer coordinates, cut to the clip rect
+	if (w < 1 || h < 1)
+		Py_RETURN_NONE;
+	x1 = (long long)x + self->view.ox + w - 1;
+	y1 = (long long)y + self->view.oy + h - 1;
+	VIEW_XY(self, x, y);
+	if (x < self->view.x0) x = self->view.x0;
+	if (y < self->view.y0) y = self->view.y0;
+	if (x1 > self->view.x1) x1 = self->view.x1;
+	if (y1 > self->view.y1) y1 = self->view.y1;
+	if (x > x1 || y > y1)
+		Py_RETURN_NONE;
+
+	PRIM_ENTRY(self, PRIM_SCROLL_REGION);
+
+	ssd1306_shift(self, x, y, (int)(x1 - x + 1), (int)(y1 - y + 1), dx, dy, fill);
+	PRIM_EXIT(self, PRIM_SCROLL_REGION);
+
+	Py_RETURN_NONE;
+}
+
+// Python error of a failed round shape
+static PyObject *
+shape_error(int res) {
+	if (res == SHAPE_TOO_BIG) {
+		PyErr_SetString(PyExc_ValueError, "radius must be up to 32767");
+		return NULL;
+	}
+
+	return PyErr_NoMemory();
+}
+
+static PyObject *
+ssd1306_drawCircle(CanvasPyObject *self, PyObject *args) {
+	int x0, y0, r, color, res;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iiii", &x0, &y0, &r, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x0, y0);
+
+	PRIM_ENTRY(self, PRIM_CIRCLE);
+
+	res = ssd1306_circle(self, x0, y0, r, 0, ssd1306_rop(self, color));
+	PRIM_EXIT(self, PRIM_CIRCLE);
+
+	if (res < 0)
+		return shape_error(res);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_fillCircle(CanvasPyObject *self, PyObject *args) {
+	int x0, y0, r, color, res;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iiii", &x0, &y0, &r, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x0, y0);
+
+	PRIM_ENTRY(self, PRIM_CIRCLE_FILL);
+
+	res = ssd1306_circle(self, x0, y0, r, 1, ssd1306_fillRop(self, color));
+	PRIM_EXIT(self, PRIM_CIRCLE_FILL);
+
+	if (res < 0)
+		return shape_error(res);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_drawEllipse(CanvasPyObject *self, PyObject *args) {
+	int x0, y0, a, b, color, res;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iiiii", &x0, &y0, &a, &b, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x0, y0);
+
+	PRIM_ENTRY(self, PRIM_ELLIPSE);
+
+	res = ssd1306_ellipse(self, x0, y0, a, b, 0, ssd1306_rop(self, color));
+	PRIM_EXIT(self, PRIM_ELLIPSE);
+
+	if (res < 0)
+		return shape_error(res);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_fillEllipse(CanvasPyObject *self, PyObject *args) {
+	int x0, y0, a, b, color, res;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iiiii", &x0, &y0, &a, &b, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x0, y0);
+
+	PRIM_ENTRY(self, PRIM_ELLIPSE_FILL);
+
+	res = ssd1306_ellipse(self, x0, y0, a, b, 1, ssd1306_fillRop(self, color));
+	PRIM_EXIT(self, PRIM_ELLIPSE_FILL);
+
+	if (res < 0)
+		return shape_error(res);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_drawRoundRect(CanvasPyObject *self, PyObject *args) {
+	int x, y, w, h, r, color, res;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iiiiii", &x, &y, &w, &h, &r, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x, y);
+
+	PRIM_ENTRY(self, PRIM_ROUND_RECT);
+
+	res = ssd1306_roundRect(self, x, y, w, h, r, 0, ssd1306_rop(self, color));
+	PRIM_EXIT(self, PRIM_ROUND_RECT);
+
+	if (res < 0)
+		return shape_error(res);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_fillRoundRect(CanvasPyObject *self, PyObject *args) {
+	int x, y, w, h, r, color, res;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iiiiii", &x, &y, &w, &h, &r, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x, y);
+
+	PRIM_ENTRY(self, PRIM_ROUND_RECT_FILL);
+
+	res = ssd1306_roundRect(self, x, y, w, h, r, 1, ssd1306_fillRop(self, color));
+	PRIM_EXIT(self, PRIM_ROUND_RECT_FILL);
+
+	if (res < 0)
+		return shape_error(res);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_triangle(CanvasPyObject *self, PyObject *args, int mode, int prim) {
+	int xs[3], ys[3], color, res;
+
+	if (!PyArg_ParseTuple(args, "iiiiiii", &xs[0], &ys[0], &xs[1], &ys[1], &xs[2], &ys[2], &color)) {
+		return NULL;
+	}
+
+	view_ints(self, xs, ys, 3);
+
+	PRIM_ENTRY(self, prim);
+
+	res = ssd1306_polygon(self, xs, ys, 3, mode, mode == POLY_OUTLINE ? ssd1306_rop(self, color) : ssd1306_fillRop(self, color));
+	PRIM_EXIT(self, prim);
+
+	if (res < 0)
+		return PyErr_NoMemory();
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_drawTriangle(CanvasPyObject *self, PyObject *args) {
+	BUSY_CHECK(self);
+
+	return ssd1306_triangle(self, args, POLY_OUTLINE, PRIM_TRIANGLE);
+}
+
+static PyObject *
+ssd1306_fillTriangle(CanvasPyObject *self, PyObject *args) {
+	BUSY_CHECK(self);
+
+	return ssd1306_triangle(self, args, POLY_NONZERO, PRIM_TRIANGLE_FILL);
+}
+
+static PyObject *
+ssd1306_drawArc(CanvasPyObject *self, PyObject *args) {
+	int x0, y0, r, start, end, color, res;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iiiiii", &x0, &y0, &r, &start, &end, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x0, y0);
+
+	PRIM_ENTRY(self, PRIM_ARC);
+
+	res = ssd1306_arc(self, x0, y0, r, start, end, 0, ssd1306_rop(self, color));
+	PRIM_EXIT(self, PRIM_ARC);
+
+	if (res < 0)
+		return shape_error(res);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_fillPie(CanvasPyObject *self, PyObject *args) {
+	int x0, y0, r, start, end, color, res;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iiiiii", &x0, &y0, &r, &start, &end, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x0, y0);
+
+	PRIM_ENTRY(self, PRIM_PIE_FILL);
+
+	res = ssd1306_arc(self, x0, y0, r, start, end, 1, ssd1306_fillRop(self, color));
+	PRIM_EXIT(self, PRIM_PIE_FILL);
+
+	if (res < 0)
+		return shape_error(res);
+
+	Py_RETURN_NONE;
+}
+
+// Vertex arrays xs, ys of polygon() and polygon_fill()
+static int *
+ssd1306_vertices(PyObject *xo, PyObject *yo, int **ys, Py_ssize_t *n) {
+	int *xs;
+	Py_ssize_t ny;
+
+	if ((xs = ssd1306_ints(xo, n)) == NULL)
+		return NULL;
+	if ((*ys = ssd1306_ints(yo, &ny)) == NULL) {
+		free(xs);
+		return NULL;
+	}
+	if (*n != ny) {
+		free(xs);
+		free(*ys);
+		PyErr_SetString(PyExc_ValueError, "xs and ys must have the same length");
+		return NULL;
+	}
+
+	return xs;
+}
+
+static PyObject *
+ssd1306_drawPolygon(CanvasPyObject *self, PyObject *args, PyObject *kwds) {
+	PyObject *xo, *yo;
+	int color, res, *xs, *ys;
+	Py_ssize_t n;
+	static char *kwlist[] = {"xs", "ys", "color", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOi", kwlist, &xo, &yo, &color)) {
+		return NULL;
+	}
+
+	if ((xs = ssd1306_vertices(xo, yo, &ys, &n)) == NULL)
+		return NULL;
+
+	view_ints(self, xs, ys, n);
+
+	PRIM_ENTRY(self, PRIM_POLYGON);
+
+	res = ssd1306_polygon(self, xs, ys, n, POLY_OUTLINE, ssd1306_rop(self, color));
+	PRIM_EXIT(self, PRIM_POLYGON);
+
+	free(xs);
+	free(ys);
+
+	if (res < 0)
+		return PyErr_NoMemory();
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_fillPolygon(CanvasPyObject *self, PyObject *args, PyObject *kwds) {
+	PyObject *xo, *yo;
+	int color, mode, res, *xs, *ys;
+	char *rule = "nonzero";
+	Py_ssize_t n;
+	static char *kwlist[] = {"xs", "ys", "color", "rule", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOi|s", kwlist, &xo, &yo, &color, &rule)) {
+		return NULL;
+	}
+
+	if (strcmp(rule, "nonzero") == 0) {
+		mode = POLY_NONZERO;
+	} else if (strcmp(rule, "evenodd") == 0) {
+		mode = POLY_EVENODD;
+	} else {
+		PyErr_SetString(PyExc_ValueError, "rule must be 'nonzero' or 'evenodd'");
+		return NULL;
+	}
+
+	if ((xs = ssd1306_vertices(xo, yo, &ys, &n)) == NULL)
+		return NULL;
+
+	view_ints(self, xs, ys, n);
+
+	PRIM_ENTRY(self, PRIM_POLYGON_FILL);
+
+	res = ssd1306_polygon(self, xs, ys, n, mode, ssd1306_fillRop(self, color));
+	PRIM_EXIT(self, PRIM_POLYGON_FILL);
+
+	free(xs);
+	free(ys);
+
+	if (res < 0)
+		return PyErr_NoMemory();
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_floodFill(CanvasPyObject *self, PyObject *args) {
+	int x, y, color, res;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "iii", &x, &y, &color)) {
+		return NULL;
+	}
+
+	VIEW_XY(self, x, y);
+
+	PRIM_ENTRY(self, PRIM_FLOOD_FILL);
+
+	res = ssd1306_flood(self, x, y, ssd1306_rop(self, color));
+	PRIM_EXIT(self, PRIM_FLOOD_FILL);
+
+	if (res < 0)
+		return PyErr_NoMemory();
+
+	Py_RETURN_NONE;
+}
+
+// Scroll step interval in frames, indexed by the 3 bit code of 26h-2Ah
+static const int scroll_intervals[8] = {5, 64, 128, 256, 3, 4, 25, 2};
+
+static int
+scroll_interval_code(int frames) {
+	int i, code = 3;	// 256 frames, the slowest
+
+	for (i=0; i<8; i++) {
+		if (scroll_intervals[i] >= frames && scroll_intervals[i] < scroll_intervals[code]) {
+			code = i;
+		}
+	}
+
+	return code;
+}
+
+// Stop the scroll engine. GDDRAM was moved by the controller, so the
+// scrolled pages are rewritten from frame to match it again.
+static void
+ssd1306_scrollStop(SSD1306PyObject *self) {
+	if (!self->scrolling)
+		return;
+
+	if (ssd1306_command(self, SSD1306_CMD_SCROLL_STOP) < 0)
+		return;
+	self->scrolling = 0;
+
+	if (self->rotation == 90 || self->rotation == 270) {
+		ssd1306_dirtyAll(CANVAS(self));
+		ssd1306_flush(self);
+		return;
+	}
+
+	ssd1306_dirty(CANVAS(self), 0, self->scroll_start * 8, SSD1306_WIDTH - 1, self->scroll_end * 8 + 7);
+	ssd1306_flushPages(self, self->scroll_start, self->scroll_end);
+}
+
+static PyObject *
+ssd1306_scroll(SSD1306PyObject *self, PyObject *args, PyObject *kwds) {
+	char *direction;
+	int start = 0, end = SSD1306_MAXROW - 1, frames = 2, vertical = 0;
+	int left, n = 0;
+	uint8_t cmd[8];
+	static char *kwlist[] = {"direction", "start", "end", "frames", "vertical", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|iiii", kwlist, &direction, &start, &end, &frames, &vertical)) {
+		return NULL;
+	}
+
+	if (strcmp(direction, "left") == 0) {
+		left = 1;
+	} else if (strcmp(direction, "right") == 0) {
+		left = 0;
+	} else {
+		PyErr_SetString(PyExc_ValueError, "direction must be 'left' or 'right'");
+		return NULL;
+	}
+
+	if (start < 0 || end >= SSD1306_MAXROW || start > end) {
+		PyErr_SetString(PyExc_ValueError, "start and end must be pages 0-7, start <= end");
+		return NULL;
+	}
+
+	if (vertical < 0 || vertical >= SSD1306_HEIGHT) {
+		PyErr_SetString(PyExc_ValueError, "vertical offset must be 0-63 rows");
+		return NULL;
+	}
+
+	// new setup is only allowed with the engine stopped
+	ssd1306_scrollStop(self);
+	if (ssd1306_ioCheck(self) < 0)
+		return NULL;
+
+	if (vertical) {
+		cmd[n++] = left ? SSD1306_CMD_SCROLL_VLEFT : SSD1306_CMD_SCROLL_VRIGHT;
+		cmd[n++] = 0x00;
+		cmd[n++] = start;
+		cmd[n++] = scroll_interval_code(frames);
+		cmd[n++] = end;
+		cmd[n++] = vertical;
+	} else {
+		cmd[n++] = left ? SSD1306_CMD_SCROLL_LEFT : SSD1306_CMD_SCROLL_RIGHT;
+		cmd[n++] = 0x00;
+		cmd[n++] = start;
+		cmd[n++] = scroll_interval_code(frames);
+		cmd[n++] = end;
+		cmd[n++] = 0x00;
+		cmd[n++] = 0xFF;
+	}
+	cmd[n++] = SSD1306_CMD_SCROLL_START;
+
+	ssd1306_commands(self, cmd, n);
+	if (ssd1306_ioCheck(self) < 0)
+		return NULL;
+
+	self->scrolling = 1;
+	// vertical scroll moves every page of the scroll area
+	self->scroll_start = vertical ? 0 : start;
+	self->scroll_end = vertical ? SSD1306_MAXROW - 1 : end;
+	// engine moves panel RAM away from the shadow
+	ssd1306_stale(self, (0xFF << self->scroll_start) & (0xFF >> (7 - self->scroll_end)));
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_scrollArea(SSD1306PyObject *self, PyObject *args) {
+	int top, rows;
+	uint8_t cmd[3];
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "ii", &top, &rows)) {
+		return NULL;
+	}
+
+	if (top < 0 || rows < 0 || top + rows > SSD1306_HEIGHT) {
+		PyErr_SetString(PyExc_ValueError, "scroll area must fit into 64 rows");
+		return NULL;
+	}
+
+	cmd[0] = SSD1306_CMD_SCROLL_AREA;
+	cmd[1] = top;
+	cmd[2] = rows;
+	ssd1306_commands(self, cmd, 3);
+	if (ssd1306_ioCheck(self) < 0)
+		return NULL;
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_scrollOff(SSD1306PyObject *self, PyObject *unused) {
+	BUSY_CHECK(self);
+
+	ssd1306_scrollStop(self);
+	if (ssd1306_ioCheck(self) < 0)
+		return NULL;
+
+	Py_RETURN_NONE;
+}
+
+/*
+ * Text console. Text lines are page aligned and the panel RAM is used
+ * as a ring: a newline at the bottom moves the display start line by
+ * one text line and only the pages of the new line are sent.
+ * frame mirrors panel RAM, page console_start is shown at the top.
+ */
+static char *
+console_line(SSD1306PyObject *self, int n) {
+	return self->scrollback + (n % self->scrollback_size) * CONSOLE_LINE_MAX;
+}
+
+static void
+ssd1306_consoleClearLine(SSD1306PyObject *self) {
+	int page = (self->console_start + self->console_row * self->console_pages) % SSD1306_MAXROW;
+
+	memset(&self->frame[page * SSD1306_WIDTH], 0x00, self->console_pages * SSD1306_WIDTH);
+	ssd1306_dirty(CANVAS(self), 0, page * 8, SSD1306_WIDTH - 1, (page + self->console_pages) * 8 - 1);
+
+	self->cursor_x = 0;
+	self->cursor_y = page * 8;
+}
+
+static void
+ssd1306_consoleNewline(SSD1306PyObject *self) {
+	int rows = SSD1306_MAXROW / self->console_pages;
+
+	if (self->console_row < rows - 1) {
+		self->console_row++;
+	} else {
+		self->console_start = (self->console_start + self->console_pages) % SSD1306_MAXROW;
+	}
+
+	ssd1306_consoleClearLine(self);
+}
+
+static void
+ssd1306_consolePut(SSD1306PyObject *self, unsigned char ch) {
+	int w;
+
+	if (ch == '\n') {
+		ssd1306_consoleNewline(self);
+		return;
+	}
+
+	w = ssd1306_charWidth(CANVAS(self), ch);
+	if (self->cursor_x + w > self->width) {
+		ssd1306_consoleNewline(self);
+	}
+
+	ssd1306_char(CANVAS(self), ch);
+	self->cursor_x += w + self->char_spacing;
+}
+
+// Append text to the console and scrollback, then send new pages and
+// the start line
+static void
+ssd1306_consoleWrite(SSD1306PyObject *self, const char *str) {
+	int start = self->console_start;
+	ssd1306_view view = self->view;	// console is in panel coordinates
+	int size = self->text_size;	// and unscaled
+	char *line;
+	size_t len;
+
+	view_full(CANVAS(self));
+	self->text_size = 1;
+
+	for (; *str; str++) {
+		if (*str == '\n') {
+			self->scrollback_head++;
+			if (self->scrollback_count < self->scrollback_size - 1) {
+				self->scrollback_count++;
+			}
+			console_line(self, self->scrollback_head)[0] = '\0';
+		} else {
+			line = console_line(self, self->scrollback_head);
+			len = strlen(line);
+			if (len < CONSOLE_LINE_MAX - 1) {
+				line[len] = *str;
+				line[len + 1] = '\0';
+			}
+		}
+
+		ssd1306_consolePut(self, *str);
+	}
+	self->view = view;
+	self->text_size = size;
+
+	ssd1306_flush(self);
+
+	if (start != self->console_start) {
+		ssd1306_command(self, SSD1306_CMD_START_LINE | (self->console_start * 8));
+	}
+}
+
+// Render the last screen of scrollback from the top of the panel RAM
+static void
+ssd1306_consoleRedraw(SSD1306PyObject *self) {
+	int rows = SSD1306_MAXROW / self->console_pages;
+	int first = self->scrollback_head - (self->scrollback_count < rows - 1 ? self->scrollback_count : rows - 1);
+	ssd1306_view view = self->view;
+	int size = self->text_size;
+	int n;
+	char *p;
+
+	view_full(CANVAS(self));
+	self->text_size = 1;
+	memset(self->frame, 0x00, SSD1306_FBSIZE);
+	ssd1306_dirtyAll(CANVAS(self));
+	self->console_start = 0;
+	self->console_row = 0;
+	ssd1306_consoleClearLine(self);
+
+	for (n=first; n<=self->scrollback_head; n++) {
+		if (n != first) {
+			ssd1306_consolePut(self, '\n');
+		}
+		for (p=console_line(self, n); *p; p++) {
+			ssd1306_consolePut(self, *p);
+		}
+	}
+	self->view = view;
+	self->text_size = size;
+
+	ssd1306_flush(self);
+	ssd1306_command(self, SSD1306_CMD_START_LINE);
+}
+
+static PyObject *
+ssd1306_setConsole(SSD1306PyObject *self, PyObject *args, PyObject *kwds) {
+	int enable = 1, size = 32, pages;
+	static char *kwlist[] = {"enable", "scrollback", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|ii", kwlist, &enable, &size)) {
+		return NULL;
+	}
+
+	if (!enable) {
+		unsigned char tmp[SSD1306_FBSIZE];
+
+		if (!self->console)
+			Py_RETURN_NONE;
+
+		// back to start line 0, frame in display order
+		memcpy(tmp, self->frame, SSD1306_FBSIZE);
+		for (pages=0; pages<SSD1306_MAXROW; pages++) {
+			memcpy(&self->frame[pages * SSD1306_WIDTH],
+				&tmp[((self->console_start + pages) % SSD1306_MAXROW) * SSD1306_WIDTH], SSD1306_WIDTH);
+		}
+		self->console = 0;
+		self->console_start = 0;
+		free(self->scrollback);
+		self->scrollback = NULL;
+
+		ssd1306_dirtyAll(CANVAS(self));
+		ssd1306_flush(self);
+		ssd1306_command(self, SSD1306_CMD_START_LINE);
+		if (ssd1306_ioCheck(self) < 0)
+			return NULL;
+
+		Py_RETURN_NONE;
+	}
+
+	if (size < 1) {
+		PyErr_SetString(PyExc_ValueError, "scrollback must be at least 1 line");
+		return NULL;
+	}
+
+	if (self->rotation == 90 || self->rotation == 270) {
+		PyErr_SetString(PyExc_ValueError, "console needs rotation 0 or 180");
+		return NULL;
+	}
+
+	if (self->scrollback == NULL || self->scrollback_size != size) {
+		free(self->scrollback);
+		self->scrollback = calloc(size, CONSOLE_LINE_MAX);
+		if (self->scrollback == NULL) {
+			return PyErr_NoMemory();
+		}
+		self->scrollback_size = size;
+		self->scrollback_head = 0;
+		self->scrollback_count = 0;
+	}
+
+	// text line height rounded up to 1, 2, 4 or 8 pages, so lines never
+	// wrap around the RAM ring
+	for (pages=1; pages<SSD1306_MAXROW && pages * 8 < self->font[FONT_HEIGHT]; pages *= 2)
+		;
+
+	ssd1306_scrollStop(self);
+	self->console = 1;
+	self->console_pages = pages;
+	ssd1306_consoleRedraw(self);
+	if (ssd1306_ioCheck(self) < 0)
+		return NULL;
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_consoleText(SSD1306PyObject *self, PyObject *unused) {
+	int n, first;
+	PyObject *list, *line;
+
+	if ((list = PyList_New(0)) == NULL)
+		return NULL;
+
+	if (!self->console)
+		return list;
+
+	first = self->scrollback_head - self->scrollback_count;
+	for (n=first; n<=self->scrollback_head; n++) {
+		line = PyString_FromString(console_line(self, n));
+		if (line == NULL || PyList_Append(list, line) < 0) {
+			Py_XDECREF(line);
+			Py_DECREF(list);
+			return NULL;
+		}
+		Py_DECREF(line);
+	}
+
+	return list;
+}
+
+// write() of SSD1306, in console mode text goes to the console
+static PyObject *
+ssd1306_write(SSD1306PyObject *self, PyObject *args, PyObject *kwds) {
+	int x, y, color = self->color;
+	PyObject *obj, *text;
+	static char *kwlist[] = {"str", "x", "y", "color", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!self->console) {
+		return ssd1306_writeString(CANVAS(self), args, kwds);
+	}
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|iii", kwlist, &obj, &x, &y, &color)) {
+		return NULL;
+	}
+
+	if ((text = ssd1306_text(obj)) == NULL)
+		return NULL;
+
+	PRIM_ENTRY(self, PRIM_WRITE);
+
+	self->color = color;
+	ssd1306_consoleWrite(self, PyBytes_AS_STRING(text));
+	PRIM_EXIT(self, PRIM_WRITE);
+	Py_DECREF(text);
+	if (ssd1306_ioCheck(self) < 0)
+		return NULL;
+
+	Py_RETURN_NONE;
+}
+
+// Segment remap and COM scan direction for rotation and mirroring.
+// 180 flips both, 90 and 270 are transposed buffer plus one flip.
+static void
+ssd1306_remap(SSD1306PyObject *self) {
+	int seg = 1, com = 1;	// init default, 0xA1 and 0xC8
+	uint8_t cmd[2];
+
+	switch (self->rotation) {
+	case 90:	seg = 0; break;
+	case 180:	seg = 0; com = 0; break;
+	case 270:	com = 0; break;
+	}
+
+	if (self->rotation == 90 || self->rotation == 270) {
+		// logical x runs along panel rows
+		com ^= self->mirror_x;
+		seg ^= self->mirror_y;
+	} else {
+		seg ^= self->mirror_x;
+		com ^= self->mirror_y;
+	}
+
+	cmd[0] = seg ? SSD1306_CMD_SEG_REMAP : SSD1306_CMD_SEG_NORMAL;
+	cmd[1] = com ? SSD1306_CMD_COM_REMAP : SSD1306_CMD_COM_NORMAL;
+	ssd1306_commands(self, cmd, 2);
+}
+
+static PyObject *
+ssd1306_rotate(SSD1306PyObject *self, PyObject *args) {
+	int rotation, portrait;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "i", &rotation)) {
+		return NULL;
+	}
+
+	if (rotation != 0 && rotation != 90 && rotation != 180 && rotation != 270) {
+		PyErr_SetString(PyExc_ValueError, "rotation must be 0, 90, 180 or 270");
+		return NULL;
+	}
+
+	portrait = rotation == 90 || rotation == 270;
+	if (portrait && self->console) {
+		PyErr_SetString(PyExc_ValueError, "console needs rotation 0 or 180");
+		return NULL;
+	}
+
+	if (portrait != (self->width < self->height)) {
+		// buffer layout changes, old content is meaningless
+		memset(self->frame, 0x00, SSD1306_FBSIZE);
+		ssd1306_spritesDrop(CANVAS(self));
+		self->width = portrait ? SSD1306_HEIGHT : SSD1306_WIDTH;
+		self->height = portrait ? SSD1306_WIDTH : SSD1306_HEIGHT;
+		ssd1306_viewReset(CANVAS(self));
+		self->cursor_x = 0;
+		self->cursor_y = 0;
+	}
+
+	self->rotation = rotation;
+	ssd1306_remap(self);
+
+	// panel RAM holds the previous layout
+	ssd1306_dirtyAll(CANVAS(self));
+	ssd1306_flush(self);
+	if (ssd1306_ioCheck(self) < 0)
+		return NULL;
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_mirror(SSD1306PyObject *self, PyObject *args, PyObject *kwds) {
+	int horizontal = 0, vertical = 0;
+	static char *kwlist[] = {"horizontal", "vertical", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "|ii", kwlist, &horizontal, &vertical)) {
+		return NULL;
+	}
+
+	self->mirror_x = horizontal != 0;
+	self->mirror_y = vertical != 0;
+	ssd1306_remap(self);
+	if (ssd1306_ioCheck(self) < 0)
+		return NULL;
+
+	Py_RETURN_NONE;
+}
+
+static inline
+int64_t now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Frame loop: callback draws at every deadline, then the buffer is flushed
+// with the GIL released. Deadlines missed entirely are skipped rather than
+// caught up, so a slow bus lowers the rate instead of piling frames up.
+static PyObject *
+ssd1306_run(SSD1306PyObject *self, PyObject *args, PyObject *kwds) {
+	PyObject *callback, *ret;
+	double fps = 30;
+	long frames = 0, slot = 0;
+	int64_t deadline, late, t0, t1, t2;
+	struct timespec ts;
+	int stop;
+	static char *kwlist[] = {"callback", "fps", "frames", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|dl", kwlist, &callback, &fps, &frames)) {
+		return NULL;
+	}
+
+	if (!PyCallable_Check(callback)) {
+		PyErr_SetString(PyExc_TypeError, "callback must be callable");
+		return NULL;
+	}
+
+	if (fps <= 0 || fps > 1000) {
+		PyErr_SetString(PyExc_ValueError, "fps must be above 0 and up to 1000");
+		return NULL;
+	}
+
+	if (frames < 0) {
+		PyErr_SetString(PyExc_ValueError, "frames must be 0 (no limit) or more");
+		return NULL;
+	}
+
+	self->frame_period = (int64_t)(1e9 / fps);
+	self->frames = 0;
+	self->frames_skipped = 0;
+	self->render_ns = 0;
+	self->flush_ns = 0;
+	self->late_max_ns = 0;
+	self->late_sq = 0;
+	self->run_start = self->run_last = deadline = now_ns();
+
+	while (frames == 0 || self->frames < frames) {
+		t0 = now_ns();
+		late = t0 - deadline;
+		if (late > self->late_max_ns) self->late_max_ns = late;
+		self->late_sq += (double)late * late;
+
+		ret = PyObject_CallFunction(callback, "l", slot);
+		if (ret == NULL)
+			return NULL;
+		stop = ret == Py_False;
+		Py_DECREF(ret);
+
+		// the callback may have handed the panel to another thread's flush
+		BUSY_CHECK(self);
+
+		t1 = now_ns();
+		self->busy = 1;
+		Py_BEGIN_ALLOW_THREADS
+		ssd1306_flush(self);
+		Py_END_ALLOW_THREADS
+		self->busy = 0;
+		t2 = now_ns();
+
+		self->frames++;
+		self->render_ns += t1 - t0;
+		self->flush_ns += t2 - t1;
+		self->run_last = t2;
+
+		if (ssd1306_ioCheck(self) < 0)
+			return NULL;
+		if (stop || PyErr_CheckSignals() < 0)
+			break;
+		if (frames && self->frames >= frames)
+			break;
+
+		deadline += self->frame_period;
+		slot++;
+		while (deadline + self->frame_period <= t2) {
+			deadline += self->frame_period;
+			slot++;
+			self->frames_skipped++;
+		}
+
+		if (deadline > t2) {
+			ts.tv_sec = deadline / 1000000000;
+			ts.tv_nsec = deadline % 1000000000;
+			Py_BEGIN_ALLOW_THREADS
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+				;
+			Py_END_ALLOW_THREADS
+		}
+	}
+
+	if (PyErr_Occurred())
+		return NULL;
+
+	return PyObject_CallMethod((PyObject *)self, "frame_stats", NULL);
+}
+
+static PyObject *
+ssd1306_frameStats(SSD1306PyObject *self, PyObject *unused) {
+	double elapsed = (self->run_last - self->run_start) / 1e9;
+	long n = self->frames ? self->frames : 1;
+
+	return Py_BuildValue("{s:l,s:l,s:d,s:d,s:d,s:d,s:d,s:d}",
+		"frames", self->frames,
+		"skipped", self->frames_skipped,
+		"target_fps", self->frame_period ? 1e9 / self->frame_period : 0.0,
+		"fps", elapsed > 0 ? self->frames / elapsed : 0.0,
+		"render_ms", self->render_ns / 1e6 / n,
+		"flush_ms", self->flush_ns / 1e6 / n,
+		"jitter_ms", sqrt(self->late_sq / n) / 1e6,
+		"late_max_ms", self->late_max_ns / 1e6);
+}
+
+static PyObject *
+ssd1306_stats(SSD1306PyObject *self, PyObject *unused) {
+	PyObject *dict, *calls, *hist, *v;
+	int i;
+
+	BUSY_CHECK(self);
+
+	dict = Py_BuildValue("{s:k,s:k,s:k,s:k,s:k}",
+		"frames", self->stat_frames,
+		"bytes", self->stat_bytes,
+		"transactions", self->stat_transactions,
+		"syscalls", self->stat_syscalls,
+		"errors", self->stat_errors);
+	calls = PyDict_New();
+	hist = PyList_New(STATS_HIST);
+	if (dict == NULL || calls == NULL || hist == NULL)
+		goto fail;
+
+	for (i=0; i<PRIM_COUNT; i++) {
+		if ((v = PyLong_FromUnsignedLong(self->calls[i])) == NULL)
+			goto fail;
+		if (PyDict_SetItemString(calls, prim_names[i], v) < 0) {
+			Py_DECREF(v);
+			goto fail;
+		}
+		Py_DECREF(v);
+	}
+
+	for (i=0; i<STATS_HIST; i++) {
+		if ((v = PyLong_FromUnsignedLong(self->stat_flush_hist[i])) == NULL)
+			goto fail;
+		PyList_SET_ITEM(hist, i, v);
+	}
+
+	if (PyDict_SetItemString(dict, "calls", calls) < 0 ||
+		PyDict_SetItemString(dict, "flush_us_log2", hist) < 0)
+		goto fail;
+
+	Py_DECREF(calls);
+	Py_DECREF(hist);
+	return dict;
+
+fail:
+	Py_XDECREF(dict);
+	Py_XDECREF(calls);
+	Py_XDECREF(hist);
+	return NULL;
+}
+
+static PyObject *
+ssd1306_resetStats(SSD1306PyObject *self, PyObject *unused) {
+	BUSY_CHECK(self);
+
+	memset(self->calls, 0, sizeof(self->calls));
+	self->stat_frames = 0;
+	self->stat_bytes = 0;
+	self->stat_transactions = 0;
+	self->stat_syscalls = 0;
+	self->stat_errors = 0;
+	memset(self->stat_flush_hist, 0, sizeof(self->stat_flush_hist));
+
+	Py_RETURN_NONE;
+}
+
+// Panel RAM image of the buffer: as is, or transposed if rotated by 90/270
+static void
+ssd1306_panelImage(SSD1306PyObject *self, uint8_t *img) {
+	int lp, m;
+
+	if (self->rotation != 90 && self->rotation != 270) {
+		memcpy(img, self->frame, SSD1306_FBSIZE);
+		return;
+	}
+
+	for (lp=0; lp<SSD1306_MAXPAGES; lp++) {
+		for (m=0; m<SSD1306_MAXROW; m++) {
+			transpose8(&self->frame[lp * SSD1306_HEIGHT + m * 8], &img[m * SSD1306_WIDTH + lp * 8]);
+		}
+	}
+}
+
+// Forget the closed stream
+static void
+ssd1306_recordClosed(SSD1306PyObject *self) {
+	free(self->rec_prev);
+	self->rec = NULL;
+	self->rec_prev = NULL;
+}
+
+// Append a frame to the stream: changed column window of every page
+static void
+ssd1306_record(SSD1306PyObject *self) {
+	uint8_t img[SSD1306_FBSIZE], out[1 + SSD1306_MAXROW * (SSD1306_WIDTH + 3)];
+	uint8_t *row, *prev;
+	int m, lo, hi, len = 1;
+
+	ssd1306_panelImage(self, img);
+	out[0] = 0;
+
+	for (m=0; m<SSD1306_MAXROW; m++) {
+		row = &img[m * SSD1306_WIDTH];
+		prev = &self->rec_prev[m * SSD1306_WIDTH];
+		lo = 0;
+		hi = SSD1306_WIDTH - 1;
+		if (self->rec_frames) {
+			while (lo <= hi && row[lo] == prev[lo])
+				lo++;
+			while (hi >= lo && row[hi] == prev[hi])
+				hi--;
+			if (lo > hi)
+				continue;
+		}
+
+		out[0]++;
+		out[len++] = m;
+		out[len++] = lo;
+		out[len++] = hi - lo;
+		memcpy(out + len, row + lo, hi - lo + 1);
+		len += hi - lo + 1;
+	}
+
+	// runs inside flush, maybe without the GIL: stop and leave the error
+	// to ssd1306_ioCheck()
+	if (fwrite(out, 1, len, self->rec) != (size_t)len) {
+		self->rec_errno = errno ? errno : EIO;
+		fclose(self->rec);
+		ssd1306_recordClosed(self);
+		return;
+	}
+	memcpy(self->rec_prev, img, SSD1306_FBSIZE);
+	self->rec_frames++;
+}
+
+// Finish the stream: frame count into the header, then close. Recording
+// is stopped either way, returns -1 with errno set if any step failed.
+static int
+ssd1306_recordStop(SSD1306PyObject *self) {
+	uint8_t count[4];
+	int i, err = 0;
+
+	if (self->rec == NULL)
+		return 0;
+
+	for (i=0; i<4; i++) {
+		count[i] = self->rec_frames >> (i * 8);
+	}
+	if (fseek(self->rec, 8, SEEK_SET) < 0 || fwrite(count, 1, 4, self->rec) != 4) {
+		err = errno ? errno : EIO;
+	}
+	if (fclose(self->rec) != 0 && err == 0) {
+		err = errno ? errno : EIO;
+	}
+	ssd1306_recordClosed(self);
+
+	if (err) {
+		errno = err;
+		return -1;
+	}
+
+	return 0;
+}
+
+static PyObject *
+ssd1306_setRecord(SSD1306PyObject *self, PyObject *args) {
+	char *path = NULL;
+	uint8_t head[STREAM_HEAD] = STREAM_MAGIC;
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTuple(args, "|z", &path)) {
+		return NULL;
+	}
+
+	if (ssd1306_recordStop(self) < 0) {
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+	// a failed frame write stopped recording already, report it here
+	// unless an update did
+	if (self->rec_errno) {
+		errno = self->rec_errno;
+		self->rec_errno = 0;
+		return PyErr_SetFromErrno(PyExc_IOError);
+	}
+	if (path == NULL)
+		Py_RETURN_NONE;
+
+	if ((self->rec_prev = malloc(SSD1306_FBSIZE)) == NULL) {
+		return PyErr_NoMemory();
+	}
+
+	if ((self->rec = fopen(path, "wb")) == NULL) {
+		free(self->rec_prev);
+		self->rec_prev = NULL;
+		return PyErr_SetFromErrnoWithFilename(PyExc_IOError, path);
+	}
+
+	if (fwrite(head, 1, STREAM_HEAD, self->rec) != STREAM_HEAD) {
+		int err = errno ? errno : EIO;
+
+		fclose(self->rec);
+		ssd1306_recordClosed(self);
+		errno = err;
+		return PyErr_SetFromErrnoWithFilename(PyExc_IOError, path);
+	}
+	self->rec_frames = 0;
+
+	Py_RETURN_NONE;
+}
+
+// Check every window of stream once, so playback needs no bound checks.
+// Returns number of frames or -1.
+static long
+stream_frames(const uint8_t *map, size_t size) {
+	size_t p = STREAM_HEAD;
+	long frames = 0;
+	int n, len;
+
+	if (size < STREAM_HEAD || memcmp(map, STREAM_MAGIC, 8) != 0)
+		return -1;
+
+	while (p < size) {
+		n = map[p++];
+		while (n--) {
+			if (p + 3 > size)
+				return -1;
+			len = map[p + 2] + 1;
+			if (map[p] >= SSD1306_MAXROW || map[p + 1] + len > SSD1306_WIDTH || p + 3 + len > size)
+				return -1;
+			p += 3 + len;
+		}
+		frames++;
+	}
+
+	return frames;
+}
+
+// Send one stream frame at *p and apply it to panel image img
+static int
+ssd1306_playFrame(SSD1306PyObject *self, const uint8_t *map, size_t *p, uint8_t *img) {
+	uint8_t cmd[3], buf[SSD1306_WIDTH + 1];
+	int n, m, lo, len;
+
+	for (n=map[(*p)++]; n>0; n--) {
+		m = map[*p];
+		lo = map[*p + 1];
+		len = map[*p + 2] + 1;
+		*p += 3;
+
+		cmd[0] = 0xb0 + m;	// page address
+		cmd[1] = lo & 0x0f;	// low column start address
+		cmd[2] = 0x10 | (lo >> 4);	// high column start address
+		buf[0] = 0x40;
+		memcpy(buf + 1, map + *p, len);
+		memcpy(&img[m * SSD1306_WIDTH + lo], map + *p, len);
+		*p += len;
+
+		ssd1306_sending(self, m);
+		if (ssd1306_commands(self, cmd, 3) < 0 || ssd1306_xfer(self, buf, len + 1) < 0) {
+			ssd1306_stale(self, 1 << m);
+			return -1;
+		}
+		ssd1306_sent(self, m, buf + 1, lo, lo + len - 1);
+	}
+
+	return 0;
+}
+
+// Play frame stream at fps straight from the mapped file. The GIL is only
+// taken between frames to check for signals.
+static PyObject *
+ssd1306_play(SSD1306PyObject *self, PyObject *args, PyObject *kwds) {
+	char *path;
+	double fps = 30;
+	int loops = 1, fd, ret = 0, lp, m, loop;
+	long played = 0, frames;
+	uint8_t cmd[2];
+	size_t size, p;
+	uint8_t *map, img[SSD1306_FBSIZE];
+	int64_t period, deadline, t;
+	struct timespec ts;
+	static char *kwlist[] = {"path", "fps", "loops", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|di", kwlist, &path, &fps, &loops)) {
+		return NULL;
+	}
+
+	if (fps <= 0 || fps > 1000) {
+		PyErr_SetString(PyExc_ValueError, "fps must be above 0 and up to 1000");
+		return NULL;
+	}
+
+	if (loops < 0) {
+		PyErr_SetString(PyExc_ValueError, "loops must be 0 (forever) or more");
+		return NULL;
+	}
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		return PyErr_SetFromErrnoWithFilename(PyExc_IOError, path);
+	}
+	size = lseek(fd, 0, SEEK_END);
+	map = size ? mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+	frames = map != MAP_FAILED ? stream_frames(map, size) : -1;
+	if (frames <= 0) {
+		if (map != MAP_FAILED) munmap(map, size);
+		// a stream without frames would loop forever without a pause
+		PyErr_SetString(PyExc_ValueError, frames < 0 ? "not a valid frame stream" : "frame stream has no frames");
+		return NULL;
+	}
+
+	// frames are panel RAM shown from start line 0, keep the scroll
+	// engine and the console start line from moving them
+	cmd[0] = SSD1306_CMD_SCROLL_STOP;
+	cmd[1] = SSD1306_CMD_START_LINE;
+	ssd1306_commands(self, cmd, 2);
+	if (ssd1306_ioCheck(self) < 0) {
+		munmap(map, size);
+		return NULL;
+	}
+	self->scrolling = 0;
+	self->console_start = 0;
+
+	ssd1306_panelImage(self, img);
+	period = (int64_t)(1e9 / fps);
+	deadline = now_ns();
+
+	self->busy = 1;
+	for (loop=0; ret == 0 && (loops == 0 || loop < loops); loop++) {
+		for (p=STREAM_HEAD; ret == 0 && p < size; played++) {
+			Py_BEGIN_ALLOW_THREADS
+			ret = ssd1306_playFrame(self, map, &p, img);
+			deadline += period;
+			t = now_ns();
+			if (deadline < t) {
+				deadline = t;	// behind, go on from now
+			} else {
+				ts.tv_sec = deadline / 1000000000;
+				ts.tv_nsec = deadline % 1000000000;
+				while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+					;
+			}
+			Py_END_ALLOW_THREADS
+
+			if (ret == 0 && PyErr_CheckSignals() < 0)
+				ret = -1;
+		}
+	}
+	self->busy = 0;
+	munmap(map, size);
+
+	// buffer takes the last image, the panel shows it already
+	if (self->rotation == 90 || self->rotation == 270) {
+		for (lp=0; lp<SSD1306_MAXPAGES; lp++) {
+			for (m=0; m<SSD1306_MAXROW; m++) {
+				transpose8(&img[m * SSD1306_WIDTH + lp * 8], &self->frame[lp * SSD1306_HEIGHT + m * 8]);
+			}
+		}
+	} else {
+		memcpy(self->frame, img, SSD1306_FBSIZE);
+	}
+	for (m=0; m<(self->height + 7) / 8; m++) {
+		self->dirty_lo[m] = self->width;
+		self->dirty_hi[m] = -1;
+	}
+	ssd1306_spritesDrop(CANVAS(self));
+
+	if (ret < 0) {
+		// stopped inside a frame, panel state is not known
+		ssd1306_dirtyAll(CANVAS(self));
+		if (PyErr_Occurred())
+			return NULL;
+		if (ssd1306_ioCheck(self) < 0)
+			return NULL;
+	}
+
+	return PyInt_FromLong(played);
+}
+
+static PyObject *
+ssd1306_setMode(CanvasPyObject *self, PyObject *args) {
+	char *mode;
+
+	if (!PyArg_ParseTuple(args, "s", &mode)) {
+		return NULL;
+	}
+
+	if (strcmp(mode, "set") == 0) {
+		self->mode = MODE_SET;
+	} else if (strcmp(mode, "clear") == 0) {
+		self->mode = MODE_CLEAR;
+	} else if (strcmp(mode, "xor") == 0) {
+		self->mode = MODE_XOR;
+	} else if (strcmp(mode, "invert") == 0) {
+		self->mode = MODE_INVERT;
+	} else {
+		PyErr_SetString(PyExc_ValueError, "mode must be 'set', 'clear', 'xor' or 'invert'");
+		return NULL;
+	}
+
+	Py_RETURN_NONE;
+}
+
+// 8x8 ordered dither thresholds, [y][x]
+static const uint8_t bayer8[8][8] = {
+	{ 0, 32,  8, 40,  2, 34, 10, 42},
+	{48, 16, 56, 24, 50, 18, 58, 26},
+	{12, 44,  4, 36, 14, 46,  6, 38},
+	{60, 28, 52, 20, 62, 30, 54, 22},
+	{ 3, 35, 11, 43,  1, 33,  9, 41},
+	{51, 19, 59, 27, 49, 17, 57, 25},
+	{15, 47,  7, 39, 13, 45,  5, 37},
+	{63, 31, 55, 23, 61, 29, 53, 21}
+};
+
+// Named fill patterns, column bytes
+static const struct {
+	const char *name;
+	uint8_t data[8];
+} pattern_names[] = {
+	{"solid", {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}},
+	{"hlines", {0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55}},
+	{"vlines", {0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00, 0xFF, 0x00}},
+	{"diagonal", {0x11, 0x88, 0x44, 0x22, 0x11, 0x88, 0x44, 0x22}},
+	{"backdiagonal", {0x11, 0x22, 0x44, 0x88, 0x11, 0x22, 0x44, 0x88}},
+	{NULL}
+};
+
+static PyObject *
+ssd1306_setPattern(CanvasPyObject *self, PyObject *args) {
+	PyObject *obj = Py_None;
+	uint8_t pat[8];
+	char *name;
+	int i, x, y, level, *a;
+	Py_ssize_t n;
+
+	if (!PyArg_ParseTuple(args, "|O", &obj)) {
+		return NULL;
+	}
+
+	if (obj == Py_None) {
+		memset(pat, 0xFF, sizeof(pat));
+	} else if (PyIndex_Check(obj)) {
+		if (!PyArg_Parse(obj, "i", &level))
+			return NULL;
+		if (level < 0 || level > 64) {
+			PyErr_SetString(PyExc_ValueError, "pattern level must be 0-64");
+			return NULL;
+		}
+		// level pixels of 64 set, spread by the Bayer matrix
+		for (x=0; x<8; x++) {
+			pat[x] = 0;
+			for (y=0; y<8; y++) {
+				if (bayer8[y][x] < level) pat[x] |= 1 << y;
+			}
+		}
+	} else if (PyString_Check(obj)) {
+		if (!PyArg_Parse(obj, "s", &name))
+			return NULL;
+		for (i=0; pattern_names[i].name != NULL; i++) {
+			if (strcmp(name, pattern_names[i].name) == 0)
+				break;
+		}
+		if (pattern_names[i].name == NULL) {
+			PyErr_SetString(PyExc_ValueError, "pattern must be 'solid', 'hlines', 'vlines', 'diagonal' or 'backdiagonal'");
+			return NULL;
+		}
+		memcpy(pat, pattern_names[i].data, sizeof(pat));
+	} else {
+		if ((a = ssd1306_ints(obj, &n)) == NULL)
+			return NULL;
+		if (n != 8) {
+			free(a);
+			PyErr_SetString(PyExc_ValueError, "pattern must be 8 column bytes");
+			return NULL;
+		}
+		for (i=0; i<8; i++)
+			pat[i] = a[i];
+		free(a);
+	}
+
+	memcpy(self->pattern, pat, sizeof(pat));
+	self->patterned = memcmp(pat, pattern_solid, sizeof(pat)) != 0;
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_setCursor(CanvasPyObject *self, PyObject *args) {
+	int x, y;
+	
+	if (!PyArg_ParseTuple(args, "ii", &x, &y)) {
+		return NULL;
+	}
+
+	self->cursor_x = x;
+	self->cursor_y = y;
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_setFont(CanvasPyObject *self, PyObject *args, PyObject *kwds) {
+	int i, spacing = 1;
+	unsigned char *font;
+	font_info *f = fonts_table;
+	static char *kwlist[] = {"font", "spacing", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|i",  kwlist, &font, &spacing)) {
+		return NULL;
+	}
+	
+	self->char_spacing = spacing;
+
+	while (f->name != NULL) {
+		if (strcmp(f->name, font) == 0) {
+			self->font = f->data;
+			break;
+		}
+		f++;
+	}
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+ssd1306_setSize(CanvasPyObject *self, PyObject *args) {
+	int size;
+
+	if (!PyArg_ParseTuple(args, "i", &size)) {
+		return NULL;
+	}
+
+	if (size < 1 || size > TEXT_SIZE_MAX) {
+		PyErr_SetString(PyExc_ValueError, "size must be 1-4");
+		return NULL;
+	}
+	self->text_size = size;
+
+	Py_RETURN_NONE;
+}
+
+// char() and write() bodies shared by the PyArg and fast call paths
+static void
+ssd1306_putChar(CanvasPyObject *self, unsigned char ch, int x, int y, int color) {
+	PRIM_ENTRY(self, PRIM_CHAR);
+
+	self->cursor_x = x;
+	self->cursor_y = y;
+	self->color = color;
+
+	ssd1306_char(self, ch);
+	PRIM_EXIT(self, PRIM_CHAR);
+}
+
+static void
+ssd1306_putString(CanvasPyObject *self, const unsigned char *str, int x, int y, int color) {
+	int i, w;
+	unsigned char ch;
+	unsigned char *font = self->font;
+	// wrap at the clip rect edges, in local coordinates
+	long long right = (long long)self->view.x1 - self->view.ox + 1;
+	long long bottom = (long long)self->view.y1 - self->view.oy + 1;
+
+	int size = self->text_size;
+
+	PRIM_ENTRY(self, PRIM_WRITE);
+
+	self->cursor_x = x;
+	self->cursor_y = y;
+	self->color = color;
+
+	for(i=0; str[i]; i++) {
+		ch = str[i];
+		w = (ssd1306_charWidth(self, ch) + self->char_spacing) * size;
+		ssd1306_char(self, ch);
+		
+		if ((self->cursor_x + w) <= right) {
+			self->cursor_x += w;
+		}
+		else if ((self->cursor_y + (font[FONT_HEIGHT] + self->char_spacing) * size) <= bottom) {
+			self->cursor_x = 0;
+			self->cursor_y += (font[FONT_HEIGHT] + self->char_spacing) * size;
+		}
+	}
+	PRIM_EXIT(self, PRIM_WRITE);
+}
+
+static PyObject *
+ssd1306_drawChar(CanvasPyObject *self, PyObject *args, PyObject *kwds) {
+	int x = self->cursor_x, y = self->cursor_y;
+	int color = 1;
+	char_arg ch;
+	static char *kwlist[] = {"ch", "x", "y", "color", NULL};
+
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, CHAR_FORMAT, kwlist, &ch, &x, &y, &color)) {
+		return NULL;
+	}
+
+	if (ch > 255) {
+		PyErr_SetString(PyExc_ValueError, "character code must be 0-255");
+		return NULL;
+	}
+
+	ssd1306_putChar(self, (unsigned char)ch, x, y, color);
+
+	Py_RETURN_NONE;
+}
+
+// Text argument as glyph codes: a bytes copy of str, Python 3 str and
+// unicode encoded as latin-1 so codes match the font tables
+static PyObject *
+ssd1306_text(PyObject *obj) {
+	PyObject *bytes;
+
+#if PY_MAJOR_VERSION < 3
+	if (PyString_Check(obj)) {
+		Py_INCREF(obj);
+		return obj;
+	}
+#endif
+	if (!PyUnicode_Check(obj)) {
+		PyErr_SetString(PyExc_TypeError, "str expected");
+		return NULL;
+	}
+
+	if ((bytes = PyUnicode_AsLatin1String(obj)) == NULL && PyErr_ExceptionMatches(PyExc_UnicodeEncodeError)) {
+		PyErr_SetString(PyExc_ValueError, "character codes must be 0-255");
+	}
+	return bytes;
+}
+
+static PyObject *
+ssd1306_writeString(CanvasPyObject *self, PyObject *args, PyObject *kwds) {
+	PyObject *obj, *text;
+	int x = self->cursor_x, y = self->cursor_y, color = self->color;
+	static char *kwlist[] = {"str", "x", "y", "color", NULL};
+	
+	BUSY_CHECK(self);
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|iii", kwlist, &obj, &x, &y, &color)) {
+		return NULL;
+	}
+
+	if ((text = ssd1306_text(obj)) == NULL)
+		return NULL;
+
+	ssd1306_putString(self, (unsigned char *)PyBytes_AS_STRING(text), x, y, color);
+	Py_DECREF(text);
+
+	Py_RETURN_NONE;
+}
+
+#ifdef SSD1306_FASTCALL
+// METH_FASTCALL entries of the hot methods. Positional calls with plain
+// ints are converted right from the argument array, anything else
+// (keywords, floats, wrong count, ...) goes the PyArg way, which also
+// produces the usual error messages.
+
+// exact ints fitting C int, -1 means take the slow path
+static int
+fast_ints(PyObject *const *args, Py_ssize_t n, int *v) {
+	Py_ssize_t i;
+	long l;
+
+	for (i=0; i<n; i++) {
+		if (!PyLong_CheckExact(args[i]))
+			return -1;
+		l = PyLong_AsLong(args[i]);
+		if ((l == -1 && PyErr_Occurred()) || l < INT_MIN || l > INT_MAX) {
+			PyErr_Clear();
+			return -1;
+		}
+		v[i] = (int)l;
+	}
+	return 0;
+}
+
+// packs the arguments back into tuple and dict for the PyArg version
+static PyObject *
+fast_slow(PyObject *self, PyCFunction func, int keywords, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+	PyObject *tuple, *dict = NULL, *res = NULL;
+	Py_ssize_t i, nkw = kwnames != NULL ? PyTuple_GET_SIZE(kwnames) : 0;
+
+	if (nkw > 0 && !keywords) {
+		PyErr_SetString(PyExc_TypeError, "function takes no keyword arguments");
+		return NULL;
+	}
+
+	if ((tuple = PyTuple_New(nargs)) == NULL)
+		return NULL;
+	for (i=0; i<nargs; i++) {
+		Py_INCREF(args[i]);
+		PyTuple_SET_ITEM(tuple, i, args[i]);
+	}
+
+	if (nkw > 0) {
+		if ((dict = PyDict_New()) == NULL)
+			goto out;
+		for (i=0; i<nkw; i++) {
+			if (PyDict_SetItem(dict, PyTuple_GET_ITEM(kwnames, i), args[nargs + i]) < 0)
+				goto out;
+		}
+	}
+
+	if (keywords)
+		res = ((PyCFunctionWithKeywords)(void (*)(void))func)(self, tuple, dict);
+	else
+		res = func(self, tuple);
+
+out:
+	Py_DECREF(tuple);
+	Py_XDECREF(dict);
+	return res;
+}
+
+static PyObject *
+fast_drawPixel(CanvasPyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+	int v[3];
+
+	BUSY_CHECK(self);
+
+	if (kwnames != NULL || nargs != 3 || fast_ints(args, 3, v) < 0)
+		return fast_slow((PyObject *)self, (PyCFunction)ssd1306_drawPixel, 0, args, nargs, kwnames);
+
+	VIEW_XY(self, v[0], v[1]);
+
+	PRIM_ENTRY(self, PRIM_PIXEL);
+
+	ssd1306_pixel(self, v[0], v[1], v[2]);
+	PRIM_EXIT(self, PRIM_PIXEL);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+fast_drawLine(CanvasPyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+	int v[5];
+
+	BUSY_CHECK(self);
+
+	if (kwnames != NULL || nargs != 5 || fast_ints(args, 5, v) < 0)
+		return fast_slow((PyObject *)self, (PyCFunction)ssd1306_drawLine, 0, args, nargs, kwnames);
+
+	VIEW_XY(self, v[0], v[1]);
+	VIEW_XY(self, v[2], v[3]);
+
+	PRIM_ENTRY(self, PRIM_LINE);
+
+	ssd1306_line(self, v[0], v[1], v[2], v[3], ssd1306_rop(self, v[4]));
+	PRIM_EXIT(self, PRIM_LINE);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+fast_fillRect(CanvasPyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+	int v[5];
+
+	BUSY_CHECK(self);
+
+	if (kwnames != NULL || nargs != 5 || fast_ints(args, 5, v) < 0)
+		return fast_slow((PyObject *)self, (PyCFunction)ssd1306_fillRect, 0, args, nargs, kwnames);
+
+	VIEW_XY(self, v[0], v[1]);
+
+	PRIM_ENTRY(self, PRIM_RECT_FILL);
+
+	ssd1306_fill(self, v[0], v[1], v[2], v[3], ssd1306_fillRop(self, v[4]));
+	PRIM_EXIT(self, PRIM_RECT_FILL);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+fast_drawChar(CanvasPyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+	int v[3] = {self->cursor_x, self->cursor_y, 1};
+
+	BUSY_CHECK(self);
+
+	if (kwnames != NULL || nargs < 1 || nargs > 4 || !PyUnicode_Check(args[0]) ||
+			PyUnicode_GET_LENGTH(args[0]) != 1 || PyUnicode_ReadChar(args[0], 0) > 255 ||
+			fast_ints(args + 1, nargs - 1, v) < 0)
+		return fast_slow((PyObject *)self, (PyCFunction)ssd1306_drawChar, 1, args, nargs, kwnames);
+
+	ssd1306_putChar(self, (unsigned char)PyUnicode_ReadChar(args[0], 0), v[0], v[1], v[2]);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *
+fast_writeString(CanvasPyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+	int v[3] = {self->cursor_x, self->cursor_y, self->color};
+
+	BUSY_CHECK(self);
+
+	// latin-1 strs are their glyph codes, NUL terminated
+	if (kwnames != NULL || nargs < 1 || nargs > 4 || !PyUnicode_Check(args[0]) ||
+			PyUnicode_READY(args[0]) < 0 || PyUnicode_KIND(args[0]) != PyUnicode_1BYTE_KIND ||
+			fast_ints(args + 1, nargs - 1, v) < 0)
+		return fast_slow((PyObject *)self, (PyCFunction)ssd1306_writeString, 1, args, nargs, kwnames);
+
+	ssd1306_putString(self, PyUnicode_1BYTE_DATA(args[0]), v[0], v[1], v[2]);
+
+	Py_RETURN_NONE;
+}
+
+// write() of SSD1306, console mode takes the PyArg path
+static PyObject *
+fast_write(SSD1306PyObject *self, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames) {
+	BUSY_CHECK(self);
+
+	if (self->console)
+		return fast_slow((PyObject *)self, (PyCFunction)ssd1306_write, 1, args, nargs, kwnames);
+
+	return fast_writeString(CANVAS(self), args, nargs, kwnames);
+}
+#endif
+
+// One I2C transaction, every bus write goes through here. EINTR and
+// EAGAIN are retried. A short write is resumed with the rest of the bytes
+// behind the same control byte, the controller keeps its column pointer.
+// Failures are counted and remembered for ssd1306_ioCheck().
+static
+int ssd1306_xfer(SSD1306PyObject *self, const uint8_t *buf, int len) {
+	uint8_t rest[SSD1306_WIDTH + 2];
+	int n, retries = SSD1306_RETRIES;
+
+	for (;;) {
+		n = write(self->fd, buf, len);
+		PROBE3(xfer, self->fd, len, n);
+		self->stat_syscalls++;
+
+		if (n < 0) {
+			if (errno == EINTR || (errno == EAGAIN && --retries > 0))
+				continue;
+			break;
+		}
+
+		self->stat_transactions++;
+		self->stat_bytes += n;
+		if (n >= len)
+			return 0;
+
+		// control byte and n - 1 payload bytes went through, only
+		// writes without progress use up retries
+		if (n > 1) {
+			rest[0] = buf[0];
+			memmove(rest + 1, buf + n, len - n);
+			len = len - n + 1;
+			buf = rest;
+		} else if (--retries <= 0) {
+			errno = EIO;
+			break;
+		}
+	}
+
+	self->stat_errors++;
+	if (self->io_errno == 0) {
+		self->io_errno = errno;
+	}
+
+	return -1;
+}
+
+static
+int ssd1306_command(SSD1306PyObject *self, uint8_t c) {
+	unsigned char buf[4] = {0};
+
+	buf[0] = 0x00;
+	buf[1] = c;
+	return ssd1306_xfer(self, buf, 2);
+}
+
+// Send whole frame buffer to the panel. Touches no Python objects, so it
+// may run with the GIL released (see SSD1306Group). Stops at the first
+// failed write, whatever was not sent stays dirty.
+static
+int ssd1306_flush(SSD1306PyObject *self) {
+	int64_t t = now_ns();
+	int64_t us;
+	int b, ret;
+
+	PROBE2(flush__start, self->fd, self->bus);
+	if (self->rec != NULL) {
+		ssd1306_record(self);
+	}
+	if (self->rotation == 90 || self->rotation == 270) {
+		ret = ssd1306_flushTransposed(self);
+	} else {
+		ret = ssd1306_flushPages(self, 0, SSD1306_MAXROW - 1);
+	}
+
+	us = (now_ns() - t) / 1000;
+	PROBE2(flush__end, self->fd, us);
+	for (b=0; us > 1 && b < STATS_HIST - 1; b++)
+		us >>= 1;
+	self->stat_flush_hist[b]++;
+	self->stat_frames++;
+
+	return ret;
+}
+
+// Narrow window lo..hi of panel page m to the bytes differing from the
+// shadow; row holds the page by panel column. Returns 0 if none differs.
+static inline
+int ssd1306_trim(SSD1306PyObject *self, int m, const uint8_t *row, int *lo, int *hi) {
+	const uint8_t *shadow;
+
+	if (self->shadow == NULL || (self->shadow_stale & (1 << m)))
+		return 1;
+
+	shadow = &self->shadow[m * SSD1306_WIDTH];
+	while (*lo <= *hi && row[*lo] == shadow[*lo])
+		(*lo)++;
+	while (*hi >= *lo && row[*hi] == shadow[*hi])
+		(*hi)--;
+
+	return *lo <= *hi;
+}
+
+// Columns lo..hi of panel page m now hold data
+static inline
+void ssd1306_sent(SSD1306PyObject *self, int m, const uint8_t *data, int lo, int hi) {
+	if (self->shadow == NULL)
+		return;
+
+	memcpy(&self->shadow[m * SSD1306_WIDTH + lo], data, hi - lo + 1);
+	if (lo == 0 && hi == SSD1306_WIDTH - 1) {
+		self->shadow_stale &= ~(1 << m);
+	}
+	self->snapshot[SNAPSHOT_STALE] = self->shadow_stale;
+}
+
+// Panel page m is about to be written. The snapshot marks it unknown until
+// ssd1306_sent(), so a process dying mid-transfer leaves no wrong image.
+static inline
+void ssd1306_sending(SSD1306PyObject *self, int m) {
+	if (self->snapshot != NULL)
+		self->snapshot[SNAPSHOT_STALE] = self->shadow_stale | (1 << m);
+}
+
+// Panel pages of mask hold unknown content, kept in the snapshot too so a
+// later attach doesn't trust them
+static inline
+void ssd1306_stale(SSD1306PyObject *self, int mask) {
+	self->shadow_stale |= mask;
+	if (self->snapshot != NULL)
+		self->snapshot[SNAPSHOT_STALE] = self->shadow_stale;
+}
+
+// Transpose 8x8 bit matrix: bit j of in[k] becomes bit k of out[j].
+// Two 32 bit halves, so it stays cheap on 32 bit MIPS.
+static inline
+void transpose8(const uint8_t *in, uint8_t *out) {
+	uint32_t lo, hi, t;
+	int j;
+
+	lo = in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+	hi = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+
+	// swap 1x1, then 2x2 blocks inside every 4x4, then 4x4 blocks
+	t = (lo ^ (lo >> 7)) & 0x00AA00AA; lo ^= t ^ (t << 7);
+	t = (hi ^ (hi >> 7)) & 0x00AA00AA; hi ^= t ^ (t << 7);
+	t = (lo ^ (lo >> 14)) & 0x0000CCCC; lo ^= t ^ (t << 14);
+	t = (hi ^ (hi >> 14)) & 0x0000CCCC; hi ^= t ^ (t << 14);
+	t = (lo ^ (hi << 4)) & 0xF0F0F0F0; lo ^= t; hi ^= t >> 4;
+
+	for (j=0; j<4; j++) {
+		out[j] = lo >> (j * 8);
+		out[j + 4] = hi >> (j * 8);
+	}
+}
+
+// Portrait buffer is 16 pages of 64 columns. Logical page lp becomes
+// panel columns lp*8..lp*8+7, logical columns x become panel page x/8;
+// every 8x8 block is transposed while the page is sent.
+static
+int ssd1306_flushTransposed(SSD1306PyObject *self) {
+	int lp, m, lo, hi;
+	int plo[SSD1306_MAXROW], phi[SSD1306_MAXROW];
+	uint8_t cmd[3], *data;
+	unsigned char tmpbuf[SSD1306_WIDTH+2];
+
+	for (m=0; m<SSD1306_MAXROW; m++) {
+		plo[m] = SSD1306_WIDTH;
+		phi[m] = -1;
+	}
+
+	for (lp=0; lp<SSD1306_MAXPAGES; lp++) {
+		if (self->dirty_lo[lp] > self->dirty_hi[lp])
+			continue;
+
+		for (m=self->dirty_lo[lp]/8; m<=self->dirty_hi[lp]/8; m++) {
+			if (lp * 8 < plo[m]) plo[m] = lp * 8;
+			if (lp * 8 + 7 > phi[m]) phi[m] = lp * 8 + 7;
+		}
+
+		self->dirty_lo[lp] = SSD1306_WIDTH;
+		self->dirty_hi[lp] = -1;
+	}
+
+	for (m=0; m<SSD1306_MAXROW; m++) {
+		lo = plo[m];
+		hi = phi[m];
+		if (lo > hi)
+			continue;
+
+		for (lp=lo/8; lp<=hi/8; lp++) {
+			transpose8(&self->frame[lp * SSD1306_HEIGHT + m * 8], &tmpbuf[1 + lp * 8 - lo]);
+		}
+
+		// tmpbuf + 1 - plo[m] is the panel page row
+		if (!ssd1306_trim(self, m, tmpbuf + 1 - plo[m], &lo, &hi))
+			continue;
+
+		cmd[0] = 0xb0 + m;	// page address
+		cmd[1] = lo & 0x0f;	// low column start address
+		cmd[2] = 0x10 | (lo >> 4);	// high column start address
+
+		data = tmpbuf + lo - plo[m];
+		data[0] = 0x40;
+
+		ssd1306_sending(self, m);
+		if (ssd1306_commands(self, cmd, 3) < 0 || ssd1306_xfer(self, data, hi - lo + 2) < 0) {
+			ssd1306_stale(self, 1 << m);
+			// logical rect of this and remaining panel pages is dirty again
+			for (; m<SSD1306_MAXROW; m++) {
+				if (plo[m] <= phi[m])
+					ssd1306_dirty(CANVAS(self), m * 8, plo[m], m * 8 + 7, phi[m]);
+			}
+			return -1;
+		}
+		ssd1306_sent(self, m, data + 1, lo, hi);
+	}
+
+	return 0;
+}
+
+// Send changed column window of every page in start..end
+static
+int ssd1306_flushPages(SSD1306PyObject *self, int start, int end) {
+	int m, lo, hi;
+	uint8_t cmd[3];
+	unsigned char tmpbuf[SSD1306_WIDTH+2];
+
+	for(m=start; m<=end; m++) {
+		lo = self->dirty_lo[m];
+		hi = self->dirty_hi[m];
+		if (lo > hi)
+			continue;
+
+		if (!ssd1306_trim(self, m, &self->frame[m * SSD1306_WIDTH], &lo, &hi)) {
+			self->dirty_lo[m] = SSD1306_WIDTH;
+			self->dirty_hi[m] = -1;
+			continue;
+		}
+
+		cmd[0] = 0xb0 + m;	// page address
+		cmd[1] = lo & 0x0f;	// low column start address
+		cmd[2] = 0x10 | (lo >> 4);	// high column start address
+		ssd1306_sending(self, m);
+		if (ssd1306_commands(self, cmd, 3) < 0)
+			return -1;
+
+		tmpbuf[0] = 0x40;
+		memcpy(tmpbuf + 1, &self->frame[m * SSD1306_WIDTH + lo], hi - lo + 1);
+
+		if (ssd1306_xfer(self, tmpbuf, hi - lo + 2) < 0) {
+			ssd1306_stale(self, 1 << m);
+			return -1;	// window stays dirty, resent next time
+		}
+		ssd1306_sent(self, m, tmpbuf + 1, lo, hi);
+
+		self->dirty_lo[m] = SSD1306_WIDTH;
+		self->dirty_hi[m] = -1;
+	}
+
+	return 0;
+}
+
+// Mark rectangle x0..x1, y0..y1 (inclusive) as changed
+static
+void ssd1306_dirty(CanvasPyObject *self, int x0, int y0, int x1, int y1) {
+	int m;
+
+	if (x0 < 0) x0 = 0;
+	if (y0 < 0) y0 = 0;
+	if (x1 >= self->width) x1 = self->width - 1;
+	if (y1 >= self->height) y1 = self->height - 1;
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	for (m=y0/8; m<=y1/8; m++) {
+		if (x0 < self->dirty_lo[m]) self->dirty_lo[m] = x0;
+		if (x1 > self->dirty_hi[m]) self->dirty_hi[m] = x1;
+	}
+}
+
+static
+void ssd1306_dirtyAll(CanvasPyObject *self) {
+	ssd1306_dirty(self, 0, 0, self->width - 1, self->height - 1);
+}
+
+// No origin, clip to the buffer
+static
+void view_full(CanvasPyObject *self) {
+	self->view.ox = self->view.oy = 0;
+	self->view.x0 = self->view.y0 = 0;
+	self->view.x1 = self->width - 1;
+	self->view.y1 = self->height - 1;
+}
+
+// Full buffer view, empty view stack
+static
+void ssd1306_viewReset(CanvasPyObject *self) {
+	view_full(self);
+	self->view_depth = 0;
+}
+
+// Several commands in one I2C transaction: control byte 0x00 (Co=0) and
+// up to 31 command bytes.
+static
+int ssd1306_commands(SSD1306PyObject *self, const uint8_t *c, int len) {
+	unsigned char buf[32];
+
+	buf[0] = 0x00;
+	memcpy(buf + 1, c, len);
+	return ssd1306_xfer(self, buf, len + 1);
+}
+
+// Bits of rows y0..y1 inside page
+static inline
+uint8_t page_mask(int page, int y0, int y1) {
+	int lo = y0 - page * 8, hi = y1 - page * 8;
+
+	if (lo < 0) lo = 0;
+	if (hi > 7) hi = 7;
+
+	return (0xFF << lo) & (0xFF >> (7 - hi));
+}
+
+// Apply raster op to bits of m in *d
+static inline
+void mask_op(uint8_t *d, uint8_t m, int rop) {
+	switch (rop) {
+	case ROP_SET:	*d |= m; break;
+	case ROP_CLEAR:	*d &= ~m; break;
+	case ROP_XOR:	*d ^= m; break;
+	}
+}
+
+// Raster op of color in current drawing mode
+static
+int ssd1306_rop(CanvasPyObject *self, int color) {
+	switch (self->mode) {
+	case MODE_CLEAR:	return ROP_CLEAR;
+	case MODE_XOR:	return color ? ROP_XOR : ROP_NOP;
+	case MODE_INVERT:	return color ? ROP_CLEAR : ROP_SET;
+	default:	return color ? ROP_SET : ROP_CLEAR;
+	}
+}
+
+// Raster op of filled areas, limited to the fill pattern if one is set
+static
+int ssd1306_fillRop(CanvasPyObject *self, int color) {
+	int rop = ssd1306_rop(self, color);
+
+	return rop != ROP_NOP && self->patterned ? rop | ROP_PATTERN : rop;
+}
+
+// Fill rectangle x..x1, y..y1 inside the buffer by page masks. Column x
+// gets the page mask under pattern byte x % 8, so a pattern fill costs the
+// same as a solid one: ends byte by byte, 8 columns from x % 8 == 0 as one
+// 64 bit word.
+static
+void fill_rect(CanvasPyObject *self, int x, int y, int x1, int y1, int rop) {
+	const uint8_t *pat = rop & ROP_PATTERN ? self->pattern : pattern_solid;
+	int i, k, m;
+	uint8_t mask[8], *row;
+	uint64_t word, mword;
+
+	rop &= ~ROP_PATTERN;
+	if (x > x1 || y > y1 || rop == ROP_NOP)
+		return;
+
+	ssd1306_dirty(self, x, y, x1, y1);
+
+	for (m=y/8; m<=y1/8; m++) {
+		for (k=0; k<8; k++)
+			mask[k] = page_mask(m, y, y1) & pat[k];
+		memcpy(&mword, mask, 8);
+		row = &self->frame[m * self->width];
+
+		for (i=x; i<=x1 && (i & 7); i++)
+			mask_op(&row[i], mask[i & 7], rop);
+		for (; i+7<=x1; i+=8) {
+			memcpy(&word, row + i, 8);
+			switch (rop) {
+			case ROP_SET:	word |= mword; break;
+			case ROP_CLEAR:	word &= ~mword; break;
+			case ROP_XOR:	word ^= mword; break;
+			}
+			memcpy(row + i, &word, 8);
+		}
+		for (; i<=x1; i++)
+			mask_op(&row[i], mask[i & 7], rop);
+	}
+}
+
+// Fill rectangle clipped to the view
+static
+void ssd1306_fill(CanvasPyObject *self, int x, int y, int w, int h, int rop) {
+	long long x1 = (long long)x + w - 1, y1 = (long long)y + h - 1;
+
+	if (x < self->view.x0) x = self->view.x0;
+	if (y < self->view.y0) y = self->view.y0;
+	if (x1 > self->view.x1) x1 = self->view.x1;
+	if (y1 > self->view.y1) y1 = self->view.y1;
+	if (x > x1 || y > y1)
+		return;
+
+	fill_rect(self, x, y, (int)x1, (int)y1, rop);
+}
+
+// Vertical span x, y0..y1: one masked byte per page
+static
+void ssd1306_vspan(CanvasPyObject *self, int x, int y0, int y1, int rop) {
+	uint8_t pat = 0xFF;
+	int m;
+
+	if (y0 > y1) swap(&y0, &y1);
+	if (x < self->view.x0 || x > self->view.x1 || y1 < self->view.y0 || y0 > self->view.y1 || rop == ROP_NOP)
+		return;
+	if (y0 < self->view.y0) y0 = self->view.y0;
+	if (y1 > self->view.y1) y1 = self->view.y1;
+
+	if (rop & ROP_PATTERN) {
+		pat = self->pattern[x & 7];
+		rop &= ~ROP_PATTERN;
+	}
+
+	ssd1306_dirty(self, x, y0, x, y1);
+
+	for (m=y0/8; m<=y1/8; m++) {
+		mask_op(&self->frame[m * self->width + x], page_mask(m, y0, y1) & pat, rop);
+	}
+}
+
+// Horizontal span x0..x1, y: same bit in consecutive bytes of one page
+static
+void ssd1306_hspan(CanvasPyObject *self, int x0, int x1, int y, int rop) {
+	uint8_t *row, bit;
+	int i;
+
+	if (x0 > x1) swap(&x0, &x1);
+	if (y < self->view.y0 || y > self->view.y1 || x1 < self->view.x0 || x0 > self->view.x1 || rop == ROP_NOP)
+		return;
+	if (x0 < self->view.x0) x0 = self->view.x0;
+	if (x1 > self->view.x1) x1 = self->view.x1;
+
+	ssd1306_dirty(self, x0, y, x1, y);
+
+	row = &self->frame[(y / 8) * self->width];
+	bit = 1 << (y & 7);
+
+	if (rop & ROP_PATTERN) {
+		for (i=x0; i<=x1; i++) mask_op(&row[i], bit & self->pattern[i & 7], rop & ~ROP_PATTERN);
+		return;
+	}
+
+	switch (rop) {
+	case ROP_SET:	for (i=x0; i<=x1; i++) row[i] |= bit; break;
+	case ROP_CLEAR:	for (i=x0; i<=x1; i++) row[i] &= ~bit; break;
+	case ROP_XOR:	for (i=x0; i<=x1; i++) row[i] ^= bit; break;
+	}
+}
+
+// Columns xa..xb of page m changed
+static inline
+void page_dirty(CanvasPyObject *self, int m, int xa, int xb) {
+	if (xa < self->dirty_lo[m]) self->dirty_lo[m] = xa;
+	if (xb > self->dirty_hi[m]) self->dirty_hi[m] = xb;
+}
+
+// Cohen-Sutherland outcode of x, y against rect x0, y0, x1, y1
+static inline
+int line_outcode(int x, int y, int x0, int y0, int x1, int y1) {
+	return (x < x0) | ((x > x1) << 1) | ((y < y0) << 2) | ((y > y1) << 3);
+}
+
+#define LINE_LIMIT	(1 << 29)	// endpoints are clamped to it, keeps deltas in int
+
+// Bresenham's algorithm - thx wikpedia. Lines with both ends on the same
+// outer side of the clip rect are rejected by outcodes, the rest is
+// clipped in Bresenham's own integer parameter: steps before the visible
+// part are skipped by computing the minor position and error there, so a
+// clipped line has exactly the pixels of the unclipped one. The inner
+// loops draw without bounds checks, keeping a byte pointer and bit of the
+// current pixel.
+static
+void ssd1306_line(CanvasPyObject *self, int x0, int y0, int x1, int y1, int rop) {
+	int steep, dx, dy, step, n, err, px, py, seg, lo, hi, m, w = self->width;
+	int amin, amax, bmin, bmax;
+	const ssd1306_view *v = &self->view;
+	long long t0, t1, k, kmin, kmax, half;
+	uint8_t bit, *p;
+
+	if (x0 == x1) {
+		ssd1306_vspan(self, x0, y0, y1, rop);
+		return;
+	}
+	if (y0 == y1) {
+		ssd1306_hspan(self, x0, x1, y0, rop);
+		return;
+	}
+
+	if (rop == ROP_NOP || (line_outcode(x0, y0, v->x0, v->y0, v->x1, v->y1) &
+			line_outcode(x1, y1, v->x0, v->y0, v->x1, v->y1)))
+		return;
+
+	if (x0 < -LINE_LIMIT) x0 = -LINE_LIMIT; else if (x0 > LINE_LIMIT) x0 = LINE_LIMIT;
+	if (y0 < -LINE_LIMIT) y0 = -LINE_LIMIT; else if (y0 > LINE_LIMIT) y0 = LINE_LIMIT;
+	if (x1 < -LINE_LIMIT) x1 = -LINE_LIMIT; else if (x1 > LINE_LIMIT) x1 = LINE_LIMIT;
+	if (y1 < -LINE_LIMIT) y1 = -LINE_LIMIT; else if (y1 > LINE_LIMIT) y1 = LINE_LIMIT;
+
+	// major axis a (x0, x1) and minor b (y0, y1) from here
+	steep = abs(y1 - y0) > abs(x1 - x0);
+	if (steep) {
+		swap(&x0, &y0);
+		swap(&x1, &y1);
+	}
+	if (x0 > x1) {
+		swap(&x0, &x1);
+		swap(&y0, &y1);
+	}
+
+	dx = x1 - x0;
+	dy = abs(y1 - y0);
+	step = y0 < y1 ? 1 : -1;
+	half = dx / 2;
+
+	// at step t the error is half - t*dy + k*dx in 0..dx-1, k minor steps
+	// taken, so k = ceil((t*dy - half) / dx) or 0; invert it for the
+	// first and last step with the minor position inside the buffer
+	amin = steep ? v->y0 : v->x0;
+	amax = steep ? v->y1 : v->x1;
+	bmin = steep ? v->x0 : v->y0;
+	bmax = steep ? v->x1 : v->y1;
+
+	t0 = (long long)amin - x0 > 0 ? (long long)amin - x0 : 0;
+	t1 = (long long)amax - x0;
+	if (t1 > dx) t1 = dx;
+
+	kmin = step > 0 ? (long long)bmin - y0 : y0 - (long long)bmax;
+	kmax = step > 0 ? (long long)bmax - y0 : y0 - (long long)bmin;
+	if (kmax < 0)
+		return;
+	if (kmin > 0 && ((kmin - 1) * dx + half) / dy + 1 > t0)
+		t0 = ((kmin - 1) * dx + half) / dy + 1;
+	if ((kmax * dx + half) / dy < t1)
+		t1 = (kmax * dx + half) / dy;
+	if (t0 > t1)
+		return;
+
+	k = t0 * dy <= half ? 0 : (t0 * dy - half + dx - 1) / dx;
+	err = (int)(half - t0 * dy + k * dx);
+	n = (int)(t1 - t0);
+
+	if (steep) {
+		px = y0 + step * (int)k;
+		py = x0 + (int)t0;
+	} else {
+		px = x0 + (int)t0;
+		py = y0 + step * (int)k;
+	}
+
+	m = py >> 3;
+	p = &self->frame[m * w + px];
+	bit = 1 << (py & 7);
+
+	if (!steep) {
+		// one column per step, bit moves up or down a row now and then
+		seg = px;
+		for (;;) {
+			mask_op(p, bit, rop);
+			if (n-- == 0)
+				break;
+			px++;
+			p++;
+			err -= dy;
+			if (err < 0) {
+				err += dx;
+				if (step > 0) {
+					bit <<= 1;
+					if (bit == 0) {
+						page_dirty(self, m, seg, px - 1);
+						bit = 0x01;
+						p += w;
+						m++;
+						seg = px;
+					}
+				} else {
+					bit >>= 1;
+					if (bit == 0) {
+						page_dirty(self, m, seg, px - 1);
+						bit = 0x80;
+						p -= w;
+						m--;
+						seg = px;
+					}
+				}
+			}
+		}
+		page_dirty(self, m, seg, px);
+	} else {
+		// one row per step, column moves left or right now and then
+		lo = hi = px;
+		for (;;) {
+			mask_op(p, bit, rop);
+			if (px < lo) lo = px;
+			if (px > hi) hi = px;
+			if (n-- == 0)
+				break;
+			bit <<= 1;
+			if (bit == 0) {
+				page_dirty(self, m, lo, hi);
+				bit = 0x01;
+				p += w;
+				m++;
+				lo = w;
+				hi = -1;
+			}
+			err -= dy;
+			if (err < 0) {
+				err += dx;
+				px += step;
+				p += step;
+			}
+		}
+		page_dirty(self, m, lo, hi);
+	}
+}
+
+// Column extents of circle radius r from the midpoint algorithm: ext[i]
+// is the half height of columns x0 - i and x0 + i, i = 0..r
+static
+void circle_ext(int r, int *ext) {
+	int f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r;
+
+	memset(ext, 0, (r + 1) * sizeof(int));
+	ext[0] = r;
+	while (x < y) {
+		if (f >= 0) {
+			y--;
+			ddF_y += 2;
+			f += ddF_y;
+		}
+		x++;
+		ddF_x += 2;
+		f += ddF_x;
+
+		if (y > ext[x]) ext[x] = y;
+		if (x > ext[y]) ext[y] = x;
+	}
+}
+
+// Same for ellipse with radii a, b: midpoint algorithm in two regions,
+// slope above and below -1, decision variables scaled by 4
+static
+void ellipse_ext(int a, int b, int *ext) {
+	long long a2 = (long long)a * a, b2 = (long long)b * b;
+	long long dx = 0, dy = 2 * a2 * b, p;
+	int i, x = 0, y = b;
+
+	for (i=0; i<=a; i++) {
+		ext[i] = -1;
+	}
+
+	p = 4 * b2 - 4 * a2 * b + a2;
+	while (dx < dy) {
+		if (y > ext[x]) ext[x] = y;
+		x++;
+		dx += 2 * b2;
+		if (p < 0) {
+			p += 4 * (dx + b2);
+		} else {
+			y--;
+			dy -= 2 * a2;
+			p += 4 * (dx - dy + b2);
+		}
+	}
+
+	p = b2 * (2 * x + 1) * (2 * x + 1) + 4 * a2 * (y - 1) * (y - 1) - 4 * a2 * b2;
+	while (y >= 0 && x <= a) {
+		if (y > ext[x]) ext[x] = y;
+		y--;
+		dy -= 2 * a2;
+		if (p > 0) {
+			p += 4 * (a2 - dy);
+		} else {
+			x++;
+			dx += 2 * b2;
+			p += 4 * (dx - dy + a2);
+		}
+	}
+
+	for (i=1; i<=a; i++) {
+		if (ext[i] < 0) ext[i] = 0;
+	}
+}
+
+// Outline part of column x of a shape with half height e around rows
+// yt..yb whose outer neighbour column reaches next (-1 if none): rows
+// the neighbour doesn't cover, as one span or a top and a bottom one
+static inline
+void shape_column(CanvasPyObject *self, int x, int yt, int yb, int e, int next, int rop) {
+	int lo = next + 1 < e ? next + 1 : e;
+
+	if (next < 0 || yt - lo + 1 >= yb + lo) {
+		ssd1306_vspan(self, x, yt - e, yb + e, rop);
+	} else {
+		ssd1306_vspan(self, x, yt - e, yt - lo, rop);
+		ssd1306_vspan(self, x, yb + lo, yb + e, rop);
+	}
+}
+
+// Symmetric shape by column extents: columns xl..xr reach ext[0] rows
+// above yt and below yb, columns xl - i and xr + i reach ext[i], i = 1..n,
+// ext nonincreasing. Fill is one vertical span per column, outline the
+// part of every column not covered by its outer neighbour; no pixel is
+// drawn twice, so xor mode works.
+static
+void ssd1306_shape(CanvasPyObject *self, int xl, int xr, int yt, int yb, const int *ext, int n, int fill, int rop) {
+	int i, e = ext[0], next = n > 0 ? ext[1] : -1;
+
+	if (rop == ROP_NOP)
+		return;
+
+	if (fill) {
+		ssd1306_fill(self, xl, yt - e, xr - xl + 1, yb - yt + 2 * e + 1, rop);
+		for (i=1; i<=n; i++) {
+			ssd1306_vspan(self, xl - i, yt - ext[i], yb + ext[i], rop);
+			ssd1306_vspan(self, xr + i, yt - ext[i], yb + ext[i], rop);
+		}
+		return;
+	}
+
+	shape_column(self, xl, yt, yb, e, next, rop);
+	if (xr > xl) {
+		shape_column(self, xr, yt, yb, e, next, rop);
+	}
+	if (xr - xl > 1) {
+		ssd1306_hspan(self, xl + 1, xr - 1, yt - e, rop);
+		if (yb + e > yt - e) {
+			ssd1306_hspan(self, xl + 1, xr - 1, yb + e, rop);
+		}
+	}
+
+	for (i=1; i<=n; i++) {
+		next = i < n ? ext[i + 1] : -1;
+		shape_column(self, xl - i, yt, yb, ext[i], next, rop);
+		shape_column(self, xr + i, yt, yb, ext[i], next, rop);
+	}
+}
+
+#define EXT_STACK	128	// extents kept on stack up to this radius
+
+// Nonzero when bounding box x0..x1, y0..y1 misses the clip rect
+static inline
+int shape_outside(CanvasPyObject *self, long long x0, long long y0, long long x1, long long y1) {
+	return x1 < self->view.x0 || y1 < self->view.y0 || x0 > self->view.x1 || y0 > self->view.y1;
+}
+
+static
+int ssd1306_circle(CanvasPyObject *self, int x0, int y0, int r, int fill, int rop) {
+	int buf[EXT_STACK + 1], *ext = buf;
+
+	if (r > SHAPE_MAX)
+		return SHAPE_TOO_BIG;
+	if (r < 0 || shape_outside(self, (long long)x0 - r, (long long)y0 - r, (long long)x0 + r, (long long)y0 + r))
+		return 0;
+	if (r > EXT_STACK && (ext = malloc((r + 1) * sizeof(int))) == NULL)
+		return -1;
+
+	circle_ext(r, ext);
+	ssd1306_shape(self, x0, x0, y0, y0, ext, r, fill, rop);
+
+	if (ext != buf)
+		free(ext);
+	return 0;
+}
+
+static
+int ssd1306_ellipse(CanvasPyObject *self, int x0, int y0, int a, int b, int fill, int rop) {
+	int buf[EXT_STACK + 1], *ext = buf;
+
+	if (a > SHAPE_MAX || b > SHAPE_MAX)
+		return SHAPE_TOO_BIG;
+	if (a < 0 || b < 0 || shape_outside(self, (long long)x0 - a, (long long)y0 - b, (long long)x0 + a, (long long)y0 + b))
+		return 0;
+	if (b == 0) {
+		ssd1306_hspan(self, x0 - a, x0 + a, y0, rop);
+		return 0;
+	}
+	if (a > EXT_STACK && (ext = malloc((a + 1) * sizeof(int))) == NULL)
+		return -1;
+
+	ellipse_ext(a, b, ext);
+	ssd1306_shape(self, x0, x0, y0, y0, ext, a, fill, rop);
+
+	if (ext != buf)
+		free(ext);
+	return 0;
+}
+
+// Rect with corners of radius r, cut down to fit the rect. Columns of the
+// straight part are all alike and rows outside the clip rect are hidden,
+// so the straight part ends are moved in to just outside the clip rect,
+// in 64 bits: span ends of huge rects stay in int range.
+static
+int ssd1306_roundRect(CanvasPyObject *self, int x, int y, int w, int h, int r, int fill, int rop) {
+	int buf[EXT_STACK + 1], *ext = buf;
+	long long xl, xr, yt, yb;
+	const ssd1306_view *v = &self->view;
+
+	if (w < 1 || h < 1)
+		return 0;
+	if (r > (w - 1) / 2) r = (w - 1) / 2;
+	if (r > (h - 1) / 2) r = (h - 1) / 2;
+	if (r > SHAPE_MAX)
+		return SHAPE_TOO_BIG;
+	if (r < 0) r = 0;
+	if (shape_outside(self, x, y, (long long)x + w - 1, (long long)y + h - 1))
+		return 0;
+
+	xl = (long long)x + r;
+	xr = (long long)x + w - 1 - r;
+	yt = (long long)y + r;
+	yb = (long long)y + h - 1 - r;
+	if (xl < v->x0 - 1) xl = xr < v->x0 - 1 ? xr : v->x0 - 1;
+	if (xr > v->x1 + 1) xr = xl > v->x1 + 1 ? xl : v->x1 + 1;
+	if (yt < v->y0 - 1) yt = yb < v->y0 - 1 ? yb : v->y0 - 1;
+	if (yb > v->y1 + 1) yb = yt > v->y1 + 1 ? yt : v->y1 + 1;
+
+	if (r > EXT_STACK && (ext = malloc((r + 1) * sizeof(int))) == NULL)
+		return -1;
+
+	circle_ext(r, ext);
+	ssd1306_shape(self, (int)xl, (int)xr, (int)yt, (int)yb, ext, r, fill, rop);
+
+	if (ext != buf)
+		free(ext);
+	return 0;
+}
+
+// sin of 0..90 degrees scaled by 16384
+static const short sin_q14[91] = {
+	0, 286, 572, 857, 1143, 1428, 1713, 1997, 2280, 2563,
+	2845, 3126, 3406, 3686, 3964, 4240, 4516, 4790, 5063, 5334,
+	5604, 5872, 6138, 6402, 6664, 6924, 7182, 7438, 7692, 7943,
+	8192, 8438, 8682, 8923, 9162, 9397, 9630, 9860, 10087, 10311,
+	10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+	12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+	14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+	15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+	16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+	16384
+};
+
+// Sector of angles start..end, clockwise from 3 o'clock on screen. A point
+// is inside by the signs of its cross products with the start and end
+// directions; octants wholly inside or outside skip that test.
+typedef struct {
+	int sx, sy, ex, ey;	// start and end directions, scaled by 16384
+	int wide;	// sweep above 180 degrees: either half plane is enough
+	char octant[8];	// 0 outside, 1 inside, 2 test the point
+} arc_sector;
+
+static
+void arc_dir(int a, int *x, int *y) {
+	int c = sin_q14[90 - a % 90], s = sin_q14[a % 90];
+
+	switch (a / 90) {
+	case 0:	*x = c; *y = s; break;
+	case 1:	*x = -s; *y = c; break;
+	case 2:	*x = -c; *y = -s; break;
+	default:	*x = s; *y = -c; break;
+	}
+}
+
+// Set up sector, returns 0 if empty and 2 if it is the whole circle
+static
+int arc_sector_init(arc_sector *sec, int start, int end) {
+	int sweep = end - start, k, rel;
+
+	if (sweep >= 360 || sweep <= -360)
+		return 2;
+	sweep %= 360;
+	if (sweep < 0) sweep += 360;
+	if (sweep == 0)
+		return 0;
+	start %= 360;
+	if (start < 0) start += 360;
+
+	arc_dir(start, &sec->sx, &sec->sy);
+	arc_dir((start + sweep) % 360, &sec->ex, &sec->ey);
+	sec->wide = sweep > 180;
+
+	for (k=0; k<8; k++) {
+		rel = (k * 45 - start + 360) % 360;
+		if (rel + 45 <= sweep)
+			sec->octant[k] = 1;
+		else if (rel > sweep && rel + 45 < 360)
+			sec->octant[k] = 0;
+		else
+			sec->octant[k] = 2;
+	}
+	return 1;
+}
+
+// Octant of offset dx, dy: 0 is 0..45 degrees, 1 is 45..90 and so on
+static inline
+int arc_octant(int dx, int dy) {
+	int o = 0, t;
+
+	if (dy < 0) {
+		dx = -dx;
+		dy = -dy;
+		o = 4;
+	}
+	if (dx <= 0) {
+		t = dx;
+		dx = dy;
+		dy = -t;
+		o += 2;
+	}
+	return dy > dx ? o + 1 : o;
+}
+
+// Offsets are below 32768 and directions 16384, products stay in int
+static inline
+int arc_has(const arc_sector *sec, int dx, int dy) {
+	int a, b;
+
+	if (dx == 0 && dy == 0)
+		return 1;	// radius 0
+	switch (sec->octant[arc_octant(dx, dy)]) {
+	case 0:	return 0;
+	case 1:	return 1;
+	}
+
+	a = sec->sx * dy - sec->sy * dx >= 0;
+	b = dx * sec->ey - dy * sec->ex >= 0;
+	return sec->wide ? a || b : a && b;
+}
+
+// Rows a..b of column dx of the circle outline, in sector, as spans
+static
+void arc_run(CanvasPyObject *self, const arc_sector *sec, int x0, int y0, int dx, int a, int b, int rop) {
+	int dy, from = a;
+
+	for (dy=a; dy<=b; dy++) {
+		if (!arc_has(sec, dx, dy)) {
+			if (dy > from)
+				ssd1306_vspan(self, x0 + dx, y0 + from, y0 + dy - 1, rop);
+			from = dy + 1;
+		}
+	}
+	if (b >= from)
+		ssd1306_vspan(self, x0 + dx, y0 + from, y0 + b, rop);
+}
+
+// Rows lo..hi of column dx where a*dy >= c, a*dy <= c if le
+static inline
+void arc_half(int a, int c, int le, int *lo, int *hi) {
+	int q;
+
+	if (a == 0) {
+		if (le ? c < 0 : c > 0) {
+			*lo = 1;
+			*hi = 0;
+		}
+		return;
+	}
+	if (a < 0) {
+		a = -a;
+		c = -c;
+		le = !le;
+	}
+	// floor of c / a
+	q = c / a;
+	if (c % a != 0 && c < 0) q--;
+	if (le) {
+		if (q < *hi) *hi = q;
+	} else {
+		if (c % a != 0) q++;
+		if (q > *lo) *lo = q;
+	}
+}
+
+// Pie column dx of half height e: the rows inside both half planes, or
+// inside either of them when the sweep is wide, one or two spans
+static
+void arc_pie_column(CanvasPyObject *self, const arc_sector *sec, int x0, int y0, int dx, int e, int rop) {
+	int alo = -e, ahi = e, blo = -e, bhi = e;
+
+	// sx*dy - sy*dx >= 0 and dx*ey - dy*ex >= 0
+	arc_half(sec->sx, sec->sy * dx, 0, &alo, &ahi);
+	arc_half(sec->ex, dx * sec->ey, 1, &blo, &bhi);
+
+	if (!sec->wide) {
+		if (blo > alo) alo = blo;
+		if (bhi < ahi) ahi = bhi;
+		if (alo <= ahi)
+			ssd1306_vspan(self, x0 + dx, y0 + alo, y0 + ahi, rop);
+		return;
+	}
+
+	if (alo > ahi || (blo <= bhi && blo < alo)) {
+		swap(&alo, &blo);
+		swap(&ahi, &bhi);
+	}
+	if (alo > ahi)
+		return;
+	if (blo <= bhi && blo <= ahi + 1) {
+		if (bhi > ahi) ahi = bhi;
+		blo = 1;
+		bhi = 0;
+	}
+	ssd1306_vspan(self, x0 + dx, y0 + alo, y0 + ahi, rop);
+	if (blo <= bhi)
+		ssd1306_vspan(self, x0 + dx, y0 + blo, y0 + bhi, rop);
+}
+
+// Arc or pie of circle radius r between angles start and end in degrees,
+// on the same outline and column extents as circle() and circle_fill()
+static
+int ssd1306_arc(CanvasPyObject *self, int x0, int y0, int r, int start, int end, int fill, int rop) {
+	int buf[EXT_STACK + 1], *ext = buf, i, e, next, lo;
+	arc_sector sec;
+
+	switch (arc_sector_init(&sec, start, end)) {
+	case 0:
+		return 0;
+	case 2:
+		return ssd1306_circle(self, x0, y0, r, fill, rop);
+	}
+
+	if (r > SHAPE_MAX)
+		return SHAPE_TOO_BIG;
+	if (r < 0 || rop == ROP_NOP || shape_outside(self, (long long)x0 - r, (long long)y0 - r, (long long)x0 + r, (long long)y0 + r))
+		return 0;
+	if (r > EXT_STACK && (ext = malloc((r + 1) * sizeof(int))) == NULL)
+		return -1;
+
+	circle_ext(r, ext);
+
+	for (i=-r; i<=r; i++) {
+		if (x0 + i < self->view.x0 || x0 + i > self->view.x1)
+			continue;
+		e = ext[abs(i)];
+		if (fill) {
+			arc_pie_column(self, &sec, x0, y0, i, e, rop);
+			continue;
+		}
+		// outline rows of the column as in ssd1306_shape()
+		next = abs(i) < r ? ext[abs(i) + 1] : -1;
+		lo = next + 1 < e ? next + 1 : e;
+		if (lo <= 0) {
+			arc_run(self, &sec, x0, y0, i, -e, e, rop);
+		} else {
+			arc_run(self, &sec, x0, y0, i, -e, -lo, rop);
+			arc_run(self, &sec, x0, y0, i, lo, e, rop);
+		}
+	}
+
+	if (ext != buf)
+		free(ext);
+	return 0;
+}
+
+// Polygon edge: columns xa..xb with y at both ends for scanline crossings,
+// and ssd1306_line's setup along major axis a and minor b for its pixels
+typedef struct {
+	int xa, ya, xb, yb, dir;
+	int steep, a0, b0, da, db, step, half;
+} poly_edge;
+
+// Edge crossing a column at y + r/d, 0 <= r < d
+typedef struct {
+	int y, r, d, dir;
+} poly_cross;
+
+static
+void poly_edge_init(poly_edge *e, int x0, int y0, int x1, int y1) {
+	e->dir = x0 < x1 ? 1 : -1;
+	if (x0 < x1) {
+		e->xa = x0; e->ya = y0; e->xb = x1; e->yb = y1;
+	} else {
+		e->xa = x1; e->ya = y1; e->xb = x0; e->yb = y0;
+	}
+
+	e->steep = abs(y1 - y0) > abs(x1 - x0);
+	if (e->steep) {
+		swap(&x0, &y0);
+		swap(&x1, &y1);
+	}
+	if (x0 > x1) {
+		swap(&x0, &x1);
+		swap(&y0, &y1);
+	}
+	e->a0 = x0;
+	e->b0 = y0;
+	e->da = x1 - x0;
+	e->db = abs(y1 - y0);
+	e->step = y0 < y1 ? 1 : -1;
+	e->half = e->da / 2;
+}
+
+// Rows lo..hi that ssd1306_line draws in column x of the edge
+static inline
+void poly_edge_rows(const poly_edge *e, int x, int *lo, int *hi) {
+	long long t, k;
+
+	if (!e->steep) {
+		t = x - e->a0;
+		k = t * e->db <= e->half ? 0 : (t * e->db - e->half + e->da - 1) / e->da;
+		*lo = *hi = e->b0 + e->step * (int)k;
+		return;
+	}
+
+	k = (long long)(x - e->b0) * e->step;
+	t = k == 0 ? 0 : ((k - 1) * e->da + e->half) / e->db + 1;
+	*lo = e->a0 + (int)t;
+	t = e->db == 0 ? e->da : (k * e->da + e->half) / e->db;
+	if (t > e->da) t = e->da;
+	*hi = e->a0 + (int)t;
+}
+
+static
+int poly_edge_cmp(const void *a, const void *b) {
+	return ((const poly_edge *)a)->xa - ((const poly_edge *)b)->xa;
+}
+
+static
+int poly_cross_cmp(const void *a, const void *b) {
+	const poly_cross *p = a, *q = b;
+	long long d;
+
+	if (p->y != q->y)
+		return p->y < q->y ? -1 : 1;
+	d = (long long)p->r * q->d - (long long)q->r * p->d;
+	return d < 0 ? -1 : d > 0;
+}
+
+static
+int poly_span_cmp(const void *a, const void *b) {
+	return ((const int *)a)[0] - ((const int *)b)[0];
+}
+
+// Add rows lo..hi cut to the clip rect to the spans of a column
+static inline
+Py_ssize_t poly_span(const ssd1306_view *v, int *spans, Py_ssize_t n, int lo, int hi) {
+	if (lo < v->y0) lo = v->y0;
+	if (hi > v->y1) hi = v->y1;
+	if (lo <= hi) {
+		spans[2 * n] = lo;
+		spans[2 * n + 1] = hi;
+		n++;
+	}
+	return n;
+}
+
+// Polygon of n vertices, closed, by columns: edges sorted by first column
+// enter the active list and leave it past their last one. Every column
+// gets the rows ssd1306_line draws for its active edges and, when filling,
+// the rows between crossings of the edges with the column centre that are
+// inside by the rule. Rows are merged and drawn as vertical spans, so the
+// outline has the pixels of line() along each edge, the fill covers it,
+// and no pixel is drawn twice.
+static
+int ssd1306_polygon(CanvasPyObject *self, const int *xs, const int *ys, Py_ssize_t n, int mode, int rop) {
+	poly_edge *edges, **active, *e;
+	poly_cross *cross;
+	int *spans, x, x1, y0, y1, xmin, xmax, ymin, ymax, lo, hi, wind;
+	Py_ssize_t i, j, next, na, nc, ns;
+	long long num;
+
+	if (n < 1 || rop == ROP_NOP)
+		return 0;
+
+	xmin = xmax = xs[0];
+	ymin = ymax = ys[0];
+	for (i=1; i<n; i++) {
+		if (xs[i] < xmin) xmin = xs[i];
+		if (xs[i] > xmax) xmax = xs[i];
+		if (ys[i] < ymin) ymin = ys[i];
+		if (ys[i] > ymax) ymax = ys[i];
+	}
+	if (shape_outside(self, xmin, ymin, xmax, ymax))
+		return 0;
+
+	edges = malloc(n * sizeof(poly_edge));
+	active = malloc(n * sizeof(poly_edge *));
+	cross = malloc(n * sizeof(poly_cross));
+	spans = malloc(4 * n * sizeof(int));
+	if (edges == NULL || active == NULL || cross == NULL || spans == NULL) {
+		free(edges);
+		free(active);
+		free(cross);
+		free(spans);
+		return -1;
+	}
+
+	for (i=0; i<n; i++) {
+		j = i + 1 < n ? i + 1 : 0;
+		x = xs[i]; y0 = ys[i]; x1 = xs[j]; y1 = ys[j];
+		if (x < -LINE_LIMIT) x = -LINE_LIMIT; else if (x > LINE_LIMIT) x = LINE_LIMIT;
+		if (y0 < -LINE_LIMIT) y0 = -LINE_LIMIT; else if (y0 > LINE_LIMIT) y0 = LINE_LIMIT;
+		if (x1 < -LINE_LIMIT) x1 = -LINE_LIMIT; else if (x1 > LINE_LIMIT) x1 = LINE_LIMIT;
+		if (y1 < -LINE_LIMIT) y1 = -LINE_LIMIT; else if (y1 > LINE_LIMIT) y1 = LINE_LIMIT;
+		poly_edge_init(&edges[i], x, y0, x1, y1);
+	}
+	qsort(edges, n, sizeof(poly_edge), poly_edge_cmp);
+
+	next = na = 0;
+	x1 = xmax < self->view.x1 ? xmax : self->view.x1;
+	for (x=xmin > self->view.x0 ? xmin : self->view.x0; x<=x1; x++) {
+		while (next < n && edges[next].xa <= x) {
+			active[na++] = &edges[next++];
+		}
+
+		ns = nc = 0;
+		for (i=j=0; i<na; i++) {
+			e = active[i];
+			if (e->xb < x)
+				continue;
+			active[j++] = e;
+
+			poly_edge_rows(e, x, &lo, &hi);
+			ns = poly_span(&self->view, spans, ns, lo, hi);
+
+			// crossings at xa..xb-1, so a vertex counts once
+			if (mode != POLY_OUTLINE && x < e->xb) {
+				num = (long long)(x - e->xa) * (e->yb - e->ya);
+				cross[nc].d = e->xb - e->xa;
+				cross[nc].y = (int)(num / cross[nc].d);
+				cross[nc].r = (int)(num % cross[nc].d);
+				if (cross[nc].r < 0) {
+					cross[nc].y--;
+					cross[nc].r += cross[nc].d;
+				}
+				cross[nc].y += e->ya;
+				cross[nc].dir = e->dir;
+				nc++;
+			}
+		}
+		na = j;
+
+		if (nc > 1) {
+			qsort(cross, nc, sizeof(poly_cross), poly_cross_cmp);
+			wind = 0;
+			for (i=0; i<nc-1; i++) {
+				wind += cross[i].dir;
+				if (mode == POLY_EVENODD ? (i & 1) : wind == 0)
+					continue;
+				ns = poly_span(&self->view, spans, ns, cross[i].y + (cross[i].r > 0), cross[i + 1].y);
+			}
+		}
+
+		if (ns == 0)
+			continue;
+		qsort(spans, ns, 2 * sizeof(int), poly_span_cmp);
+		lo = spans[0];
+		hi = spans[1];
+		for (i=1; i<ns; i++) {
+			if (spans[2 * i] > hi + 1) {
+				ssd1306_vspan(self, x, lo, hi, rop);
+				lo = spans[2 * i];
+				hi = spans[2 * i + 1];
+			} else if (spans[2 * i + 1] > hi) {
+				hi = spans[2 * i + 1];
+			}
+		}
+		ssd1306_vspan(self, x, lo, hi, rop);
+	}
+
+	free(edges);
+	free(active);
+	free(cross);
+	free(spans);
+	return 0;
+}
+
+#define FLOOD_STACK	256	// seeds kept on the C stack before growing on the heap
+
+static inline
+int flood_get(CanvasPyObject *self, int x, int y) {
+	return (self->frame[(y >> 3) * self->width + x] >> (y & 7)) & 1;
+}
+
+// First row of y..y1 in column x with pixel other than v, y1 + 1 if none.
+// Whole pages of v are skipped by one byte compare.
+static
+int flood_down(CanvasPyObject *self, int x, int y, int y1, int v) {
+	uint8_t d;
+	int r;
+
+	while (y <= y1) {
+		d = self->frame[(y >> 3) * self->width + x];
+		d = (v ? ~d : d) & (0xFF << (y & 7));
+		if (d) {
+			for (r=y&7; !(d & (1 << r)); r++);
+			y = (y & ~7) + r;
+			return y <= y1 ? y : y1 + 1;
+		}
+		y = (y & ~7) + 8;
+	}
+	return y1 + 1;
+}
+
+// Same upwards: last row of y0..y with pixel other than v, y0 - 1 if none
+static
+int flood_up(CanvasPyObject *self, int x, int y, int y0, int v) {
+	uint8_t d;
+	int r;
+
+	while (y >= y0) {
+		d = self->frame[(y >> 3) * self->width + x];
+		d = (v ? ~d : d) & (0xFF >> (7 - (y & 7)));
+		if (d) {
+			for (r=y&7; !(d & (1 << r)); r--);
+			y = (y & ~7) + r;
+			return y >= y0 ? y : y0 - 1;
+		}
+		y = (y & ~7) - 1;
+	}
+	return y0 - 1;
+}
+
+// Fill 4-connected area of pixels equal to the one at x, y inside the clip
+// rect. A seed pops into a vertical run of the column, filled as one span,
+// and pushes the first row of every run it touches in both neighbouring
+// columns. The rop must change the area color, so filled pixels are never
+// seeded again: every row of a column is pushed at most once from each
+// side, which bounds the stack to the clip rect size.
+static
+int ssd1306_flood(CanvasPyObject *self, int x, int y, int rop) {
+	const ssd1306_view *v = &self->view;
+	int buf[FLOOD_STACK], *stack = buf, *tmp, size = FLOOD_STACK, n = 0;
+	int a, b, c, k, v0;
+
+	if (x < v->x0 || x > v->x1 || y < v->y0 || y > v->y1)
+		return 0;
+
+	v0 = flood_get(self, x, y);
+	if (rop == ROP_NOP || rop == (v0 ? ROP_SET : ROP_CLEAR))
+		return 0;
+
+	stack[n++] = y * self->width + x;
+	while (n) {
+		k = stack[--n];
+		x = k % self->width;
+		y = k / self->width;
+		if (flood_get(self, x, y) != v0)
+			continue;	// filled since it was pushed
+
+		a = flood_up(self, x, y, v->y0, v0) + 1;
+		b = flood_down(self, x, y, v->y1, v0) - 1;
+		ssd1306_vspan(self, x, a, b, rop);
+
+		for (c=x-1; c<=x+1; c+=2) {
+			if (c < v->x0 || c > v->x1)
+				continue;
+			for (y=a; (y = flood_down(self, c, y, b, !v0)) <= b; y = flood_down(self, c, y, b, v0) + 1) {
+				if (n == size) {
+					tmp = stack == buf ? malloc(2 * size * sizeof(int)) : realloc(stack, 2 * size * sizeof(int));
+					if (tmp == NULL) {
+						if (stack != buf)
+							free(stack);
+						return -1;
+					}
+					if (stack == buf)
+						memcpy(tmp, buf, sizeof(buf));
+					stack = tmp;
+					size *= 2;
+				}
+				stack[n++] = y * self->width + c;
+			}
+		}
+	}
+
+	if (stack != buf)
+		free(stack);
+	return 0;
+}
+
+// Combine byte v into *d under mask m
+static inline
+void blit_op(uint8_t *d, uint8_t v, uint8_t m, int op) {
+	switch (op) {
+	case BLIT_OR:	*d |= v & m; break;
+	case BLIT_AND:	*d &= v | ~m; break;
+	case BLIT_XOR:	*d ^= v & m; break;
+	default:	*d = (*d & ~m) | (v & m); break;
+	}
+}
+
+// Combine page-major bitmap src (w x h, w bytes per page) into the buffer
+// at x, y, clipped to the view. One byte operation per column and page;
+// when y is not page aligned every source byte is split between two
+// destination pages.
+static
+void ssd1306_blit(CanvasPyObject *self, int x, int y, const uint8_t *src, int w, int h, int op) {
+	int c, sp, dp, c0, c1;
+	int pages = (h + 7) / 8, p0 = self->view.y0 >> 3, p1 = self->view.y1 >> 3;
+	int q = y >> 3, r = y & 7;	// floor, also for negative y
+	uint8_t v, m, lm, hm;
+	uint8_t *lo, *hi;
+
+	c0 = x < self->view.x0 ? self->view.x0 - x : 0;
+	c1 = (long long)x + w - 1 > self->view.x1 ? self->view.x1 - x + 1 : w;
+	if (c0 >= c1 || y > self->view.y1 || (long long)y + h - 1 < self->view.y0)
+		return;
+
+	ssd1306_dirty(self, x + c0, y, x + c1 - 1, y + h - 1);
+
+	for (sp=0; sp<pages; sp++) {
+		dp = q + sp;
+		if (dp < p0 - 1 || dp > p1)
+			continue;
+
+		m = page_mask(sp, 0, h - 1);
+		lm = dp >= p0 ? (m << r) & page_mask(dp, self->view.y0, self->view.y1) : 0;
+		hm = r && dp + 1 <= p1 ? (m >> (8 - r)) & page_mask(dp + 1, self->view.y0, self->view.y1) : 0;
+		lo = &self->frame[dp * self->width + x];
+		hi = lo + self->width;
+
+		for (c=c0; c<c1; c++) {
+			v = src[sp * w + c];
+			if (lm) blit_op(&lo[c], v << r, lm, op);
+			if (hm) blit_op(&hi[c], v >> (8 - r), hm, op);
+		}
+	}
+}
+
+// Move pixels of region by dx, dy inside the region, revealed pixels get
+// fill color. Horizontal moves are memmove of page rows, vertical moves
+// shift column bytes across page boundaries.
+static
+void ssd1306_shift(CanvasPyObject *self, int x, int y, int w, int h, int dx, int dy, int fill) {
+	int i, m, q, r, src, x1, y1, pages = (self->height + 7) / 8;
+	uint8_t mask, lo, hi, val, *row;
+
+	x1 = x + w - 1;
+	y1 = y + h - 1;
+	if (x < 0) x = 0;
+	if (y < 0) y = 0;
+	if (x1 >= self->width) x1 = self->width - 1;
+	if (y1 >= self->height) y1 = self->height - 1;
+	if (x > x1 || y > y1)
+		return;
+	w = x1 - x + 1;
+	h = y1 - y + 1;
+
+	if (dx <= -w || dx >= w || dy <= -h || dy >= h) {
+		fill_rect(self, x, y, x1, y1, fill ? ROP_SET : ROP_CLEAR);
+		return;
+	}
+
+	ssd1306_dirty(self, x, y, x1, y1);
+
+	if (dx) {
+		for (m=y/8; m<=y1/8; m++) {
+			mask = page_mask(m, y, y1);
+			row = &self->frame[m * self->width];
+
+			if (mask == 0xFF) {
+				if (dx > 0) {
+					memmove(row + x + dx, row + x, w - dx);
+				} else {
+					memmove(row + x, row + x - dx, w + dx);
+				}
+			} else if (dx > 0) {
+				for (i=x1; i>=x+dx; i--) row[i] = (row[i] & ~mask) | (row[i - dx] & mask);
+			} else {
+				for (i=x; i<=x1+dx; i++) row[i] = (row[i] & ~mask) | (row[i - dx] & mask);
+			}
+		}
+
+		if (dx > 0) {
+			fill_rect(self, x, y, x + dx - 1, y1, fill ? ROP_SET : ROP_CLEAR);
+		} else {
+			fill_rect(self, x1 + dx + 1, y, x1, y1, fill ? ROP_SET : ROP_CLEAR);
+		}
+	}
+
+	if (dy) {
+		for (i=x; i<=x1; i++) {
+			// down: bottom page first, up: top page first, so every
+			// source byte is read before it is overwritten
+			for (m = dy > 0 ? y1/8 : y/8; dy > 0 ? m >= y/8 : m <= y1/8; m += dy > 0 ? -1 : 1) {
+				src = m * 8 - dy;	// row landing on bit 0 of page m
+				q = src >> 3;
+				r = src & 7;
+
+				// rows below height in the last page are not pixels
+				lo = (q >= 0 && q < pages) ? self->frame[q * self->width + i] & page_mask(q, 0, self->height - 1) : 0;
+				hi = (q + 1 >= 0 && q + 1 < pages) ? self->frame[(q + 1) * self->width + i] & page_mask(q + 1, 0, self->height - 1) : 0;
+				val = r ? (lo >> r) | (hi << (8 - r)) : lo;
+
+				mask = page_mask(m, y, y1);
+				self->frame[m * self->width + i] = (self->frame[m * self->width + i] & ~mask) | (val & mask);
+			}
+		}
+
+		if (dy > 0) {
+			fill_rect(self, x, y, x1, y + dy - 1, fill ? ROP_SET : ROP_CLEAR);
+		} else {
+			fill_rect(self, x, y1 + dy + 1, x1, y1, fill ? ROP_SET : ROP_CLEAR);
+		}
+	}
+}
+
+// Draw sprite at its position saving the bytes under it, or restore them.
+// Only bits under the sprite mask change, one byte per column and page.
+static
+void ssd1306_spriteDraw(CanvasPyObject *self, ssd1306_sprite *s, int restore) {
+	int k, c, dp, c0, c1, y0, y1, size = s->pages * s->w;
+	int q = s->y >> 3, r = s->y & 7;	// floor, also for negative y
+	const uint8_t *img = s->data + r * size, *msk = s->data + (8 + r) * size;
+	uint8_t m, lim, *d, *sv;
+
+	// part inside the clip rect it was shown with, inside the buffer
+	c0 = s->x < s->x0 ? s->x0 - s->x : 0;
+	c1 = s->x + s->w > s->x1 + 1 ? s->x1 + 1 - s->x : s->w;
+	y0 = s->y < s->y0 ? s->y0 : s->y;
+	y1 = s->y + s->h - 1 > s->y1 ? s->y1 : s->y + s->h - 1;
+	if (c0 >= c1 || y0 > y1)
+		return;
+
+	ssd1306_dirty(self, s->x + c0, y0, s->x + c1 - 1, y1);
+
+	for (k=0; k<s->pages; k++) {
+		dp = q + k;
+		if (dp < y0 >> 3 || dp > y1 >> 3)
+			continue;
+
+		lim = page_mask(dp, y0, y1);
+		d = &self->frame[dp * self->width + s->x];
+		sv = &s->save[k * s->w];
+
+		if (restore) {
+			for (c=c0; c<c1; c++) {
+				m = msk[k * s->w + c] & lim;
+				d[c] = (d[c] & ~m) | (sv[c] & m);
+			}
+		} else {
+			for (c=c0; c<c1; c++) {
+				m = msk[k * s->w + c] & lim;
+				sv[c] = d[c];
+				d[c] = (d[c] & ~m) | (img[k * s->w + c] & m);
+			}
+		}
+	}
+}
+
+static inline
+int sprite_hits(ssd1306_sprite *s, int x, int y, int w, int h) {
+	return s->x < x + w && x < s->x + s->w && s->y < y + h && y < s->y + s->h;
+}
+
+// Move sprite id to x, y, or just take it off if show is 0. Higher ids are
+// on top: those overlapping the old or new place are taken off first and
+// drawn again after, so every save-under stays valid.
+static
+void ssd1306_spriteMove(CanvasPyObject *self, int id, int x, int y, int show) {
+	ssd1306_sprite *s = &self->sprites[id], *t;
+	int i;
+
+	for (i=self->sprite_count-1; i>id; i--) {
+		t = &self->sprites[i];
+		t->lifted = t->data && t->visible &&
+			((s->visible && sprite_hits(t, s->x, s->y, s->w, s->h)) ||
+			(show && sprite_hits(t, x, y, s->w, s->h)));
+		if (t->lifted) {
+			ssd1306_spriteDraw(self, t, 1);
+		}
+	}
+
+	if (s->visible) {
+		ssd1306_spriteDraw(self, s, 1);
+	}
+
+	s->x = x;
+	s->y = y;
+	s->visible = show;
+	if (show) {
+		s->x0 = self->view.x0;
+		s->y0 = self->view.y0;
+		s->x1 = self->view.x1;
+		s->y1 = self->view.y1;
+		ssd1306_spriteDraw(self, s, 0);
+	}
+
+	for (i=id+1; i<self->sprite_count; i++) {
+		t = &self->sprites[i];
+		if (t->lifted) {
+			ssd1306_spriteDraw(self, t, 0);
+			t->lifted = 0;
+		}
+	}
+}
+
+// Buffer was wiped, there is nothing to restore
+static
+void ssd1306_spritesDrop(CanvasPyObject *self) {
+	int i;
+
+	for (i=0; i<self->sprite_count; i++) {
+		self->sprites[i].visible = 0;
+	}
+}
+
+static
+void ssd1306_spritesFree(CanvasPyObject *self) {
+	int i;
+
+	for (i=0; i<self->sprite_count; i++) {
+		free(self->sprites[i].data);
+		free(self->sprites[i].save);
+	}
+	free(self->sprites);
+	self->sprites = NULL;
+	self->sprite_count = 0;
+}
+
+// Row of value v, vmin on the bottom row and vmax on the top one
+static inline
+int chart_row(ssd1306_chart *c, int v) {
+	long long span = c->vmax - c->vmin, d = v - c->vmin;
+
+	if (d < 0) d = 0;
+	if (d > span) d = span;
+
+	return c->y + c->h - 1 - (int)((d * (c->h - 1) + span / 2) / span);
+}
+
+// Auto scale: range of kept samples plus 1/8 headroom, changed only when
+// a sample leaves it or the samples use less than half of it, so slow
+// drift doesn't redraw the chart on every append. Returns 1 if changed.
+static
+int ssd1306_chartScale(ssd1306_chart *c) {
+	long long lo, hi, need, pad;
+	int i, k;
+
+	if (c->count == 0)
+		return 0;
+
+	lo = hi = c->lo[c->head];
+	for (i=0; i<c->count; i++) {
+		k = (c->head + i) % c->w;
+		if (c->lo[k] < lo) lo = c->lo[k];
+		if (c->hi[k] > hi) hi = c->hi[k];
+	}
+
+	need = hi - lo > 0 ? hi - lo : 1;
+	if (lo >= c->vmin && hi <= c->vmax && need * 2 >= c->vmax - c->vmin)
+		return 0;
+
+	pad = need / 16;
+	c->vmin = lo - pad;
+	c->vmax = lo + need + pad;
+	return 1;
+}
+
+// Draw chart columns from..to: per page of the column one byte store,
+// background and sample run merged under the chart rows mask
+static
+void ssd1306_chartDraw(CanvasPyObject *self, ssd1306_chart *c, int from, int to) {
+	int col, i, k, m, x, top, bottom, prev, x0, y0, x1, y1;
+	uint8_t bg, fg, *d;
+
+	if (!chart_clip(c, &x0, &y0, &x1, &y1))
+		return;
+	if (from < x0 - c->x) from = x0 - c->x;
+	if (to > x1 - c->x) to = x1 - c->x;
+	if (from > to)
+		return;
+
+	for (col=from; col<=to; col++) {
+		x = c->x + col;
+
+		// sample i of the ring shows in column w - count + i
+		i = col - (c->w - c->count);
+		top = 0;
+		bottom = -1;
+		if (i >= 0) {
+			k = (c->head + i) % c->w;
+			switch (c->style) {
+			case CHART_LINE:
+				top = bottom = chart_row(c, c->lo[k]);
+				if (i > 0) {
+					prev = chart_row(c, c->lo[(k + c->w - 1) % c->w]);
+					if (prev < top) top = prev + 1;
+					else if (prev > bottom) bottom = prev - 1;
+				}
+				break;
+			case CHART_BAR:
+				top = chart_row(c, c->hi[k]);
+				bottom = c->y + c->h - 1;
+				break;
+			case CHART_BAND:
+				top = chart_row(c, c->hi[k]);
+				bottom = chart_row(c, c->lo[k]);
+				break;
+			}
+		}
+
+		for (m=y0>>3; m<=y1>>3; m++) {
+			bg = page_mask(m, y0, y1);
+			fg = top <= bottom && top < m * 8 + 8 && bottom >= m * 8 ? page_mask(m, top, bottom) & bg : 0;
+			d = &self->frame[m * self->width + x];
+			*d = c->color ? (*d & ~bg) | fg : (*d | bg) & ~fg;
 		}
-		f++;
 	}
 
-	Py_RETURN_NONE;
+	ssd1306_dirty(self, c->x + from, y0, c->x + to, y1);
 }
 
-static PyObject *
-ssd1306_drawChar(SSD1306PyObject *self, PyObject *args, PyObject *kwds) {
-	int x = self->cursor_x, y = self->cursor_y, size = 1;
-	int color = 1, bg = 0;
-	unsigned char ch;
-	static char *kwlist[] = {"ch", "x", "y", "color", NULL};
+static
+void ssd1306_chartsFree(CanvasPyObject *self) {
+	int i;
 
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "c|iii", kwlist, &ch, &x, &y, &color)) {
-		return NULL;
+	for (i=0; i<self->chart_count; i++) {
+		free(self->charts[i].lo);
 	}
-	
-	self->cursor_x = x;
-	self->cursor_y = y;
-	self->color = color;
+	free(self->charts);
+	self->charts = NULL;
+	self->chart_count = 0;
+}
 
-	ssd1306_char(self, ch);
-	
-	Py_RETURN_NONE;
+static
+void ssd1306_pixel(CanvasPyObject *self, int x, int y, int color) {
+	ssd1306_plot(self, x, y, ssd1306_rop(self, color));
 }
 
-static PyObject *
-ssd1306_writeString(SSD1306PyObject *self, PyObject *args, PyObject *kwds) {
-	int i, w;
-	unsigned char *str, ch;
-	int x = self->cursor_x, y = self->cursor_y, color = self->color;
-	static char *kwlist[] = {"str", "x", "y", "color", NULL};
-	unsigned char *font = self->font;
-	
-	if (!PyArg_ParseTupleAndKeywords(args, kwds, "s|iii", kwlist, &str, &x, &y, &color)) {
-		return NULL;
-	}
-	
-	self->cursor_x = x;
-	self->cursor_y = y;
-	self->color = color;
+static
+void ssd1306_plot(CanvasPyObject *self, int x, int y, int rop) {
+	int row;
 
-	for(i=0; i<strlen(str); i++) {
-		ch = str[i];
-		w = ssd1306_charWidth(self, ch) + self->char_spacing;
-		ssd1306_char(self, ch);
-		
-		if ((self->cursor_x + w) <= self->width) {
-			self->cursor_x += w;
-		}
-		else if ((self->cursor_y + font[FONT_HEIGHT] + self->char_spacing) <= self->height) {
-			self->cursor_x = 0;
-			self->cursor_y += font[FONT_HEIGHT] + self->char_spacing;
-		}
-	}
+	if (x < self->view.x0 || x > self->view.x1 || y < self->view.y0 || y > self->view.y1)
+		return;
 
-	Py_RETURN_NONE;
+	row = y / 8;
+	if (x < self->dirty_lo[row]) self->dirty_lo[row] = x;
+	if (x > self->dirty_hi[row]) self->dirty_hi[row] = x;
+
+	mask_op(&self->frame[row * self->width + x], 1 << (y % 8), rop);
 }
 
+// Points xs[i], ys[i]: clipped and drawn in one loop, the changed
+// area is marked once at the end
 static
-void ssd1306_command(SSD1306PyObject *self, uint8_t c) {
-	unsigned char buf[4] = {0};
+void ssd1306_points(CanvasPyObject *self, const int *xs, const int *ys, Py_ssize_t n, int rop) {
+	int x, y, w = self->width, h = self->height;
+	int x0 = w, y0 = h, x1 = -1, y1 = -1;
+	int cx = self->view.x0, cy = self->view.y0;
+	unsigned cw = self->view.x1 - cx, ch = self->view.y1 - cy;
+	Py_ssize_t i;
 
-	buf[0] = 0x00;
-	buf[1] = c;
-	write(self->fd, buf, 2);
+	if (rop == ROP_NOP || self->view.x0 > self->view.x1)
+		return;
+
+	for (i=0; i<n; i++) {
+		x = xs[i];
+		y = ys[i];
+		if ((unsigned)(x - cx) > cw || (unsigned)(y - cy) > ch)
+			continue;
+
+		if (x < x0) x0 = x;
+		if (x > x1) x1 = x;
+		if (y < y0) y0 = y;
+		if (y > y1) y1 = y;
+
+		mask_op(&self->frame[(y >> 3) * w + x], 1 << (y & 7), rop);
+	}
+
+	if (x1 >= 0)
+		ssd1306_dirty(self, x0, y0, x1, y1);
 }
 
+// Sample ys[i] at column x0 + i. With connect every column gets a
+// vertical run from next to the previous sample, so steep edges stay
+// continuous; one masked byte per page either way.
 static
-void ssd1306_pixel(SSD1306PyObject *self, int x, int y, int color) {
-	unsigned char row;
-	unsigned char offset;
-	unsigned char preData;	//previous data.
-	unsigned char val;
-	int16_t  index;
+void ssd1306_trace(CanvasPyObject *self, int x0, const int *ys, Py_ssize_t n, int rop, int connect) {
+	int x, y, lo, hi, m, w = self->width, h = self->height;
+	int xa = w, ya = h, xb = -1, yb = -1;
+	Py_ssize_t i = 0;
 
-	if ((x < 0) || (x >= self->width) || (y < 0) || (y >= self->height))
+	if (rop == ROP_NOP)
 		return;
 
-	//get the previous data;
-	row = y / 8;
-	offset = y % 8;
-	index = row * self->width + x;
-	preData = self->frame[index];
+	if (x0 < self->view.x0)
+		i = (Py_ssize_t)self->view.x0 - x0;
+
+	for (; i<n && x0 + i <= self->view.x1; i++) {
+		x = x0 + i;
+		y = lo = hi = ys[i];
+		if (connect && i > 0) {
+			if (ys[i-1] < y) lo = ys[i-1] + 1;
+			else if (ys[i-1] > y) hi = ys[i-1] - 1;
+		}
+		if (lo < self->view.y0) lo = self->view.y0;
+		if (hi > self->view.y1) hi = self->view.y1;
+		if (lo > hi)
+			continue;
+
+		if (x < xa) xa = x;
+		xb = x;
+		if (lo < ya) ya = lo;
+		if (hi > yb) yb = hi;
+
+		for (m=lo>>3; m<=hi>>3; m++) {
+			mask_op(&self->frame[m * w + x], page_mask(m, lo, hi), rop);
+		}
+	}
+
+	if (xb >= 0)
+		ssd1306_dirty(self, xa, ya, xb, yb);
+}
+
+// Glyph bytes of scaled text: bit n of byte v repeated size times from
+// bit n * size, index size - 2
+static uint32_t glyph_expand[TEXT_SIZE_MAX - 1][256];
 
-	//set pixel;
-	val = 1 << offset;
-	if(color != 0) {	//white! set bit.
-		self->frame[index] = preData | val;
-	} else {	//black! clear bit.
-		self->frame[index] = preData & (~val);
+static
+void glyph_expand_init(void) {
+	int size, v, b;
+
+	for (size=2; size<=TEXT_SIZE_MAX; size++) {
+		for (v=0; v<256; v++) {
+			glyph_expand[size - 2][v] = 0;
+			for (b=0; b<8; b++) {
+				if (v & (1 << b))
+					glyph_expand[size - 2][v] |= ((1u << size) - 1) << (b * size);
+			}
+		}
 	}
 }
 
+// One glyph byte: fg rop on set bits and bg rop on clear bits of v under
+// mask m, bit 0 lands on row y. Split between two pages if y is unaligned,
+// rows outside the clip rect are masked off. The background may be a
+// pattern fill.
+static inline
+void ssd1306_glyphByte(CanvasPyObject *self, int x, int y, uint8_t v, uint8_t m, int fg, int bg) {
+	int q = y >> 3, r = y & 7, y0 = self->view.y0, y1 = self->view.y1;
+	uint8_t k, pat = 0xFF, *d;
+
+	if (bg & ROP_PATTERN) {
+		pat = self->pattern[x & 7];
+		bg &= ~ROP_PATTERN;
+	}
+	if (q >= y0 >> 3 && q <= y1 >> 3) {
+		d = &self->frame[q * self->width + x];
+		k = (m << r) & page_mask(q, y0, y1);
+		mask_op(d, (v << r) & k, fg);
+		mask_op(d, ~(v << r) & k & pat, bg);
+	}
+	if (r && q + 1 >= y0 >> 3 && q + 1 <= y1 >> 3) {
+		d = &self->frame[(q + 1) * self->width + x];
+		k = (m >> (8 - r)) & page_mask(q + 1, y0, y1);
+		mask_op(d, (v >> (8 - r)) & k, fg);
+		mask_op(d, ~(v >> (8 - r)) & k & pat, bg);
+	}
+}
 
+// Glyph at the text cursor, which is moved by the view origin
 static
-int ssd1306_char(SSD1306PyObject *self, unsigned char ch) {
-	int bX = self->cursor_x, bY = self->cursor_y, fgcolour = self->color, bgcolour = self->bg_color;
-	int i, j, k;
+int ssd1306_char(CanvasPyObject *self, unsigned char ch) {
+	int bX = view_add(self->cursor_x, self->view.ox), bY = view_add(self->cursor_y, self->view.oy);
+	int fg = ssd1306_rop(self, self->color), bg;
+	int i, j, j0, j1, k, k0, k1, b, size = self->text_size;
+	uint32_t ev, em;
 	char c = ch;
 	unsigned char *font = self->font;
 	uint8_t width = 0;
 	uint8_t height = font[FONT_HEIGHT];
 	uint8_t bytes = (height + 7) / 8;
+	uint8_t rows = height < 8 ? height + 1 : height;	// drawn rows, small fonts get a spacing row
 	uint8_t firstChar = font[FONT_FIRST_CHAR];
 	uint8_t charCount = font[FONT_CHAR_COUNT];
 	uint16_t index = 0;
 
-	if (bX >= self->width || bY >= self->height) return -1;
+	// background is opaque only in set and invert modes
+	bg = (self->mode == MODE_SET || self->mode == MODE_INVERT) ? ssd1306_fillRop(self, self->bg_color) : ROP_NOP;
+
+	if (bX > self->view.x1 || bY > self->view.y1) return -1;
 
 	if (c == ' ') {
 		width = ssd1306_charWidth(self, ' ');
-		PyObject *pArgs = Py_BuildValue("iiiii", bX, bY, bX + width, bY + height, bgcolour);
-		ssd1306_fillRect(self, pArgs);
+		ssd1306_fill(self, bX, bY, width * size, height * size, bg);
 
 		return width;
 	}
@@ -507,28 +5393,41 @@ int ssd1306_char(SSD1306PyObject *self, unsigned char ch) {
 		width = font[FONT_WIDTH_TABLE + c];
 	}
 
-	if (bX < -width || bY < -height) return width;
+	// drawn columns inside the clip rect
+	j0 = bX < self->view.x0 ? self->view.x0 - bX : 0;
+	j1 = bX + width * size - 1 > self->view.x1 ? self->view.x1 - bX : width * size - 1;
+	if (j0 > j1 || bY + rows * size - 1 < self->view.y0) return width;
 
-	// last but not least, draw the character
-	for (j = 0; j < width; j++) { // Width
-		// for (i = bytes - 1; i < 254; i--) { // Vertical Bytes
+	ssd1306_dirty(self, bX + j0, bY, bX + j1, bY + rows * size - 1);
+
+	// last but not least, draw the character: font data is page-major
+	// like the buffer, except the last byte of a column is bottom aligned.
+	// Scaled text widens every font byte to size bytes by lookup table and
+	// draws each font column size times.
+	for (j = j0 / size; j <= j1 / size; j++) { // Width
+		k0 = j * size > j0 ? j * size : j0;
+		k1 = j * size + size - 1 < j1 ? j * size + size - 1 : j1;
 		for (i = 0; i < bytes; i++) { // Vertical Bytes
 			uint8_t data = font[index + j + (i * width)];
-			int offset = (i * 8);
+			uint8_t mask = page_mask(i, 0, rows - 1);
 
 			if ((i == bytes - 1) && bytes > 1) {
-				offset = height - 8;
+				data >>= bytes * 8 - height;
 			} else if (height<8) {
-				offset = height - 7;
+				data >>= 7 - height;
 			}
 
-			for (k = 0; k < 8; k++) { // Vertical bits
-				if ((offset+k >= i*8) && (offset+k <= height)) {
-					if (data & (1 << k)) {
-						ssd1306_pixel(self, bX + j, bY + offset + k, fgcolour);
-					} else {
-						ssd1306_pixel(self, bX + j, bY + offset + k, bgcolour);
-					}
+			if (size == 1) {
+				ssd1306_glyphByte(self, bX + j, bY + i * 8, data, mask, fg, bg);
+				continue;
+			}
+			ev = glyph_expand[size - 2][data];
+			em = glyph_expand[size - 2][mask];
+			for (b = 0; b < size; b++) {
+				if ((uint8_t)(em >> (b * 8)) == 0)
+					continue;
+				for (k = k0; k <= k1; k++) {
+					ssd1306_glyphByte(self, bX + k, bY + (i * size + b) * 8, ev >> (b * 8), em >> (b * 8), fg, bg);
 				}
 			}
 		}
@@ -538,7 +5437,7 @@ int ssd1306_char(SSD1306PyObject *self, unsigned char ch) {
 }
 
 static
-int ssd1306_charWidth(SSD1306PyObject *self, unsigned char ch) {
+int ssd1306_charWidth(CanvasPyObject *self, unsigned char ch) {
     char c = ch;
 
     // Space is often not included in font so use width of 'n'
@@ -546,7 +5445,7 @@ int ssd1306_charWidth(SSD1306PyObject *self, unsigned char ch) {
     uint8_t width = 0;
 
     uint8_t firstChar = self->font[FONT_FIRST_CHAR];
-    uint8_t charCount = self->font[FONT_FIRST_CHAR];
+    uint8_t charCount = self->font[FONT_CHAR_COUNT];
 
     uint16_t index = 0;
 
@@ -577,43 +5476,179 @@ void swap(int *a, int *b)
 }
 
 
-static PyMethodDef ssd1306_methods[] = {
-	{"update", (PyCFunction)ssd1306_update, METH_NOARGS,
-		"update()\n\n Update OLED display image from buffer."},
-	{"clear", (PyCFunction)ssd1306_clear, METH_NOARGS,
-		"clear()\n\n Clear OLED display."},
-	{"pixel", (PyCFunction)ssd1306_drawPixel, METH_VARARGS,
-		"pixel(x, y, color)\n\n Draws pixel at specified location and color on OLED display."},
+static PyMethodDef canvas_methods[] = {
+	{"clear", (PyCFunction)canvas_clear, METH_NOARGS,
+		"clear()\n\n Clear buffer."},
+	HOT_METHOD("pixel", fast_drawPixel, ssd1306_drawPixel, METH_VARARGS,
+		"pixel(x, y, color)\n\n Draws pixel at specified location and color on OLED display."),
 	{"circle", (PyCFunction)ssd1306_drawCircle, METH_VARARGS,
 		"circle(x, y, radius, color)\n\n Draws circle at specified location, radius and color on OLED display."},
-	{"line", (PyCFunction)ssd1306_drawLine, METH_VARARGS,
-		"line(x0, y0, x1, y1, color)\n\n Draws line at specified locations and color on OLED display."},
+	{"pixels", (PyCFunction)ssd1306_drawPixels, METH_VARARGS | METH_KEYWORDS,
+		"pixels(xs, ys, color)\n\n Draws pixels at locations xs[i], ys[i], both integer arrays (array, bytes, numpy, ...) or sequences."},
+	{"plot", (PyCFunction)ssd1306_drawPlot, METH_VARARGS | METH_KEYWORDS,
+		"plot(ys, x0=0, color=1, connect=0)\n\n Draws samples ys as pixels in columns from x0, connect joins them by vertical runs."},
+	HOT_METHOD("line", fast_drawLine, ssd1306_drawLine, METH_VARARGS,
+		"line(x0, y0, x1, y1, color)\n\n Draws line at specified locations and color on OLED display."),
+	{"circle_fill", (PyCFunction)ssd1306_fillCircle, METH_VARARGS,
+		"circle_fill(x, y, radius, color)\n\n Draws filled circle at specified location, radius and color on OLED display."},
+	{"ellipse", (PyCFunction)ssd1306_drawEllipse, METH_VARARGS,
+		"ellipse(x, y, rx, ry, color)\n\n Draws ellipse at specified location, radii and color on OLED display."},
+	{"ellipse_fill", (PyCFunction)ssd1306_fillEllipse, METH_VARARGS,
+		"ellipse_fill(x, y, rx, ry, color)\n\n Draws filled ellipse at specified location, radii and color on OLED display."},
+	{"arc", (PyCFunction)ssd1306_drawArc, METH_VARARGS,
+		"arc(x, y, radius, start, end, color)\n\n Draws part of circle from angle start to end in degrees, clockwise from 3 o'clock."},
+	{"pie_fill", (PyCFunction)ssd1306_fillPie, METH_VARARGS,
+		"pie_fill(x, y, radius, start, end, color)\n\n Draws filled pie slice of circle from angle start to end in degrees, clockwise from 3 o'clock."},
+	{"flood_fill", (PyCFunction)ssd1306_floodFill, METH_VARARGS,
+		"flood_fill(x, y, color)\n\n Fills area of pixels connected to x, y having its color, up to the clip rect."},
 	{"line_vertical", (PyCFunction)ssd1306_drawFastVLine, METH_VARARGS,
 		"line_vertical(x, y, len, color)\n\n Draws vertical line at specified location, length and color on OLED display."},
 	{"line_horisontal", (PyCFunction)ssd1306_drawFastHLine, METH_VARARGS,
 		"line_horisontal(x, y, len, color)\n\n Draws horisontal line at specified location, length and color on OLED display."},
 	{"rect", (PyCFunction)ssd1306_drawRect, METH_VARARGS,
 		"rect(x, y, w, h, color)\n\n Draws rect at specified location, width, height and color on OLED display."},
-	{"rect_fill", (PyCFunction)ssd1306_fillRect, METH_VARARGS,
-		"rect_fill(x, y, w, h, color)\n\n Draws and fills rect at specified location, width, height and color on OLED display."},
+	HOT_METHOD("rect_fill", fast_fillRect, ssd1306_fillRect, METH_VARARGS,
+		"rect_fill(x, y, w, h, color)\n\n Draws and fills rect at specified location, width, height and color on OLED display."),
+	{"round_rect", (PyCFunction)ssd1306_drawRoundRect, METH_VARARGS,
+		"round_rect(x, y, w, h, r, color)\n\n Draws rect with corners of radius r at specified location, width, height and color on OLED display."},
+	{"round_rect_fill", (PyCFunction)ssd1306_fillRoundRect, METH_VARARGS,
+		"round_rect_fill(x, y, w, h, r, color)\n\n Draws and fills rect with corners of radius r at specified location, width, height and color on OLED display."},
+	{"triangle", (PyCFunction)ssd1306_drawTriangle, METH_VARARGS,
+		"triangle(x0, y0, x1, y1, x2, y2, color)\n\n Draws triangle with specified corners and color on OLED display."},
+	{"triangle_fill", (PyCFunction)ssd1306_fillTriangle, METH_VARARGS,
+		"triangle_fill(x0, y0, x1, y1, x2, y2, color)\n\n Draws filled triangle with specified corners and color on OLED display."},
+	{"polygon", (PyCFunction)ssd1306_drawPolygon, METH_VARARGS | METH_KEYWORDS,
+		"polygon(xs, ys, color)\n\n Draws closed polygon with corners xs[i], ys[i] (integer arrays as for pixels())."},
+	{"polygon_fill", (PyCFunction)ssd1306_fillPolygon, METH_VARARGS | METH_KEYWORDS,
+		"polygon_fill(xs, ys, color, rule='nonzero')\n\n Draws filled polygon with corners xs[i], ys[i], rule 'nonzero' or 'evenodd' decides which parts of a self-crossing polygon are inside."},
+	{"scroll_region", (PyCFunction)ssd1306_scrollRegion, METH_VARARGS | METH_KEYWORDS,
+		"scroll_region(x, y, w, h, dx, dy, fill=0)\n\n Move pixels of rect by dx, dy inside it, revealed pixels are set to fill color."},
+	{"blit", (PyCFunction)canvas_blit, METH_VARARGS | METH_KEYWORDS,
+		"blit(src, x=0, y=0, op='copy')\n\n Composite canvas src at specified location with 'copy', 'or', 'and' or 'xor'."},
+	{"sprite_add", (PyCFunction)canvas_spriteAdd, METH_VARARGS | METH_KEYWORDS,
+		"sprite_add(image, mask=None) -> id\n\n Register canvas image as hidden sprite, mask canvas selects opaque pixels (all if None)."},
+	{"sprite_move", (PyCFunction)canvas_spriteMove, METH_VARARGS,
+		"sprite_move(id, x, y)\n\n Show sprite at specified location, background under the old place is restored."},
+	{"sprite_hide", (PyCFunction)canvas_spriteHide, METH_VARARGS,
+		"sprite_hide(id)\n\n Take sprite off the buffer, restoring the background."},
+	{"sprite_remove", (PyCFunction)canvas_spriteRemove, METH_VARARGS,
+		"sprite_remove(id)\n\n Hide sprite and free it, id may be reused by sprite_add()."},
+	{"chart_add", (PyCFunction)canvas_chartAdd, METH_VARARGS | METH_KEYWORDS,
+		"chart_add(x, y, w, h, style='line', min=0, max=0, color=1) -> id\n\n Add chart of the last w samples in rect, style 'line', 'bar' or 'band'. Auto scale unless max > min."},
+	{"chart_append", (PyCFunction)canvas_chartAppend, METH_VARARGS | METH_KEYWORDS,
+		"chart_append(id, value, high=None)\n\n Append sample (or integer array of samples), high is the band top. Draws only new columns."},
+	{"chart_draw", (PyCFunction)canvas_chartDraw, METH_VARARGS,
+		"chart_draw(id)\n\n Redraw whole chart from its samples, e.g. after clear()."},
+	{"chart_remove", (PyCFunction)canvas_chartRemove, METH_VARARGS,
+		"chart_remove(id)\n\n Free chart, its pixels stay in buffer."},
+	{"mode", (PyCFunction)ssd1306_setMode, METH_VARARGS,
+		"mode(name)\n\n Set drawing mode of all primitives and text: 'set', 'clear', 'xor' or 'invert'."},
+	{"push", (PyCFunction)canvas_push, METH_NOARGS,
+		"push()\n\n Save origin and clip rect, pop() restores them."},
+	{"pop", (PyCFunction)canvas_pop, METH_NOARGS,
+		"pop()\n\n Restore origin and clip rect saved by the last push()."},
+	{"translate", (PyCFunction)canvas_translate, METH_VARARGS,
+		"translate(dx, dy)\n\n Move origin of primitives and text by dx, dy in current coordinates."},
+	{"clip", (PyCFunction)canvas_clip, METH_VARARGS,
+		"clip(x, y, w, h)\n\n Limit drawing to rect in current coordinates, intersected with the current clip rect."},
+	{"pattern", (PyCFunction)ssd1306_setPattern, METH_VARARGS,
+		"pattern(p=None)\n\n Set pattern of filled primitives and text background: None or 'solid', dither level 0-64, 'hlines', 'vlines', 'diagonal', 'backdiagonal' or 8 column bytes."},
 	{"cursor", (PyCFunction)ssd1306_setCursor, METH_VARARGS,
 		"cursor(x, y)\n\n Set text cursor at specified location."},
 	{"font", (PyCFunction)ssd1306_setFont, METH_VARARGS | METH_KEYWORDS,
 		"font(name, spacing=1)\n\n Set text font name and char spacing."},
-	{"char", (PyCFunction)ssd1306_drawChar, METH_VARARGS | METH_KEYWORDS,
-		"char(ch, x=0, y=0, color=1)\n\n Draw char at current or specified position with current font and size."},
-	{"write", (PyCFunction)ssd1306_writeString, METH_VARARGS | METH_KEYWORDS,
-		"write(string, x=0, y=0, color=1)\n\n Draw string at current or specified position with current font and size."},
+	{"size", (PyCFunction)ssd1306_setSize, METH_VARARGS,
+		"size(n)\n\n Set text size: glyphs and spacing of char() and write() scaled 1, 2, 3 or 4 times."},
+	HOT_METHOD("char", fast_drawChar, ssd1306_drawChar, METH_VARARGS | METH_KEYWORDS,
+		"char(ch, x=0, y=0, color=1)\n\n Draw char at current or specified position with current font and size."),
+	HOT_METHOD("write", fast_writeString, ssd1306_writeString, METH_VARARGS | METH_KEYWORDS,
+		"write(string, x=0, y=0, color=1)\n\n Draw string at current or specified position with current font and size."),
+	{NULL}
+};
+
+static PyTypeObject CanvasObjectType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"Canvas",		/* tp_name        */
+	sizeof(CanvasPyObject),		/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	(destructor)canvas_dealloc,	/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	0,				/* tp_repr        */
+	0,				/* tp_as_number   */
+	0,				/* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	0,				/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,	/* tp_flags       */
+	"Canvas(width, height) -> canvas\n\nReturn a new offscreen buffer supporting all drawing methods, composite it with blit().\n",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	canvas_methods,	/* tp_methods        */
+	canvas_members,	/* tp_members        */
+	0,				/* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)canvas_init,		/* tp_init           */
+};
+
+static PyMethodDef ssd1306_methods[] = {
+	{"update", (PyCFunction)ssd1306_update, METH_VARARGS | METH_KEYWORDS,
+		"update(full=0)\n\n Update OLED display image from buffer. Only changed areas are sent unless full is set."},
+	{"reinit", (PyCFunction)ssd1306_reinit, METH_NOARGS,
+		"reinit()\n\n Send setup commands again and the whole buffer, e.g. after the controller lost power."},
+	{"clear", (PyCFunction)ssd1306_clear, METH_NOARGS,
+		"clear()\n\n Clear OLED display."},
+	{"scroll", (PyCFunction)ssd1306_scroll, METH_VARARGS | METH_KEYWORDS,
+		"scroll(direction, start=0, end=7, frames=2, vertical=0)\n\n Start hardware scroll of pages start..end to 'left' or 'right', one step every frames. Nonzero vertical adds vertical scroll by that many rows per step."},
+	{"scroll_area", (PyCFunction)ssd1306_scrollArea, METH_VARARGS,
+		"scroll_area(top, rows)\n\n Set vertical scroll area: top fixed rows and number of scrolled rows."},
+	{"scroll_stop", (PyCFunction)ssd1306_scrollOff, METH_NOARGS,
+		"scroll_stop()\n\n Stop hardware scroll and restore scrolled pages from buffer."},
+	{"console", (PyCFunction)ssd1306_setConsole, METH_VARARGS | METH_KEYWORDS,
+		"console(enable=1, scrollback=32)\n\n Enable or disable text console mode: write() appends text and updates the display, newline scrolls by hardware start line."},
+	{"console_text", (PyCFunction)ssd1306_consoleText, METH_NOARGS,
+		"console_text()\n\n Return list of console scrollback lines, oldest first."},
+	{"rotate", (PyCFunction)ssd1306_rotate, METH_VARARGS,
+		"rotate(angle)\n\n Set display rotation: 0, 90, 180 or 270 degrees. 90 and 270 make buffer 64x128 and clear it."},
+	{"mirror", (PyCFunction)ssd1306_mirror, METH_VARARGS | METH_KEYWORDS,
+		"mirror(horizontal=0, vertical=0)\n\n Mirror display image by hardware remap."},
+	{"run", (PyCFunction)ssd1306_run, METH_VARARGS | METH_KEYWORDS,
+		"run(callback, fps=30, frames=0) -> stats\n\n Call callback(slot) and update display at fps rate until it returns False or frames are done."},
+	{"frame_stats", (PyCFunction)ssd1306_frameStats, METH_NOARGS,
+		"frame_stats()\n\n Return dict of run() frame timing: frames, skipped, fps, render, flush and jitter times."},
+	{"stats", (PyCFunction)ssd1306_stats, METH_NOARGS,
+		"stats()\n\n Return dict of driver counters: frames, bytes, transactions, syscalls, errors, primitive calls and flush time histogram."},
+	{"reset_stats", (PyCFunction)ssd1306_resetStats, METH_NOARGS,
+		"reset_stats()\n\n Zero all stats() counters."},
+	{"record", (PyCFunction)ssd1306_setRecord, METH_VARARGS,
+		"record(path=None)\n\n Record every update to frame stream file path, None stops recording."},
+	{"play", (PyCFunction)ssd1306_play, METH_VARARGS | METH_KEYWORDS,
+		"play(path, fps=30, loops=1) -> frames\n\n Play frame stream file on the display at fps rate, loops times or forever if 0."},
+	HOT_METHOD("write", fast_write, ssd1306_write, METH_VARARGS | METH_KEYWORDS,
+		"write(string, x=0, y=0, color=1)\n\n Draw string at current or specified position with current font and size. In console mode append it to the console."),
 	{NULL}
 };
 
 static PyTypeObject SSD1306ObjectType = {
-	PyObject_HEAD_INIT(NULL)
-	0,				/* ob_size        */
+	PyVarObject_HEAD_INIT(NULL, 0)
 	"SSD1306",		/* tp_name        */
 	sizeof(SSD1306PyObject),		/* tp_basicsize   */
 	0,				/* tp_itemsize    */
-	0,				/* tp_dealloc     */
+	(destructor)ssd1306_dealloc,	/* tp_dealloc     */
 	0,				/* tp_print       */
 	0,				/* tp_getattr     */
 	0,				/* tp_setattr     */
@@ -647,20 +5682,301 @@ static PyTypeObject SSD1306ObjectType = {
 	(initproc)ssd1306_init,		/* tp_init           */
 };
 
-PyMODINIT_FUNC
-initssd1306_i2c(void) 
+/*
+ * SSD1306Group - several panels flushed together.
+ * Panels are bucketed by I2C bus: every bus gets its own native worker
+ * thread, panels sharing a bus are flushed one after another by that
+ * worker. Total refresh time is the slowest bus, not the sum of panels.
+ */
+typedef struct {
+	SSD1306PyObject **panels;	/* panels of this bus, borrowed from displays */
+	int count;
+} ssd1306_bus_job;
+
+typedef struct {
+	PyObject_HEAD
+
+	PyObject *displays;	/* tuple of SSD1306 objects */
+	SSD1306PyObject **panels;	/* displays ordered by bus */
+	ssd1306_bus_job *jobs;
+	pthread_t *threads;
+	int nbuses;
+} SSD1306GroupPyObject;
+
+static PyMemberDef ssd1306_group_members[] = {
+	{"displays", T_OBJECT_EX, offsetof(SSD1306GroupPyObject, displays), READONLY,
+		"Tuple of grouped SSD1306 objects"},
+	{NULL}  /* Sentinel */
+};
+
+static void
+ssd1306_group_free(SSD1306GroupPyObject *self) {
+	Py_CLEAR(self->displays);
+	free(self->panels);
+	free(self->jobs);
+	free(self->threads);
+	self->panels = NULL;
+	self->jobs = NULL;
+	self->threads = NULL;
+	self->nbuses = 0;
+}
+
+static void
+ssd1306_group_dealloc(SSD1306GroupPyObject *self) {
+	ssd1306_group_free(self);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int
+ssd1306_group_init(SSD1306GroupPyObject *self, PyObject *args, PyObject *kwds) {
+	int i, j, n, count;
+	PyObject *seq, *displays;
+	SSD1306PyObject *panel;
+	static char *kwlist[] = {"displays", NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "O", kwlist, &seq))
+		return -1;
+
+	if ((displays = PySequence_Tuple(seq)) == NULL)
+		return -1;
+
+	n = PyTuple_GET_SIZE(displays);
+	for (i=0; i<n; i++) {
+		if (!PyObject_TypeCheck(PyTuple_GET_ITEM(displays, i), &SSD1306ObjectType)) {
+			PyErr_SetString(PyExc_TypeError, "SSD1306Group accepts only SSD1306 objects");
+			Py_DECREF(displays);
+			return -1;
+		}
+	}
+
+	ssd1306_group_free(self);
+	self->displays = displays;
+	self->panels = malloc((n + 1) * sizeof(*self->panels));
+	self->jobs = malloc((n + 1) * sizeof(*self->jobs));
+	self->threads = malloc((n + 1) * sizeof(*self->threads));
+	if (self->panels == NULL || self->jobs == NULL || self->threads == NULL) {
+		ssd1306_group_free(self);
+		PyErr_NoMemory();
+		return -1;
+	}
+
+	// stable bucketing by bus number, keeps user order inside a bus
+	count = 0;
+	for (i=0; i<n; i++) {
+		panel = (SSD1306PyObject *)PyTuple_GET_ITEM(displays, i);
+
+		for (j=0; j<count; j++) {
+			if (self->panels[j]->bus == panel->bus)
+				break;
+		}
+		if (j < count)
+			continue;
+
+		self->jobs[self->nbuses].panels = &self->panels[count];
+		for (j=i; j<n; j++) {
+			SSD1306PyObject *p = (SSD1306PyObject *)PyTuple_GET_ITEM(displays, j);
+			if (p->bus == panel->bus)
+				self->panels[count++] = p;
+		}
+		self->jobs[self->nbuses].count = &self->panels[count] - self->jobs[self->nbuses].panels;
+		self->nbuses++;
+	}
+
+	return 0;
+}
+
+static void *
+ssd1306_group_worker(void *arg) {
+	ssd1306_bus_job *job = arg;
+	int i;
+
+	for (i=0; i<job->count; i++) {
+		ssd1306_flush(job->panels[i]);
+	}
+
+	return NULL;
+}
+
+static PyObject *
+ssd1306_group_update(SSD1306GroupPyObject *self, PyObject *unused) {
+	int i;
+	char started[self->nbuses + 1];
+
+	if (self->nbuses == 0)
+		Py_RETURN_NONE;
+
+	// panels are flushed without the GIL, keep other threads off them
+	for (i=0; i<PyTuple_GET_SIZE(self->displays); i++) {
+		BUSY_CHECK((SSD1306PyObject *)PyTuple_GET_ITEM(self->displays, i));
+	}
+	for (i=0; i<PyTuple_GET_SIZE(self->displays); i++) {
+		((SSD1306PyObject *)PyTuple_GET_ITEM(self->displays, i))->busy = 1;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	// first bus is served by the calling thread
+	for (i=1; i<self->nbuses; i++) {
+		started[i] = pthread_create(&self->threads[i], NULL, ssd1306_group_worker, &self->jobs[i]) == 0;
+	}
+
+	ssd1306_group_worker(&self->jobs[0]);
+
+	for (i=1; i<self->nbuses; i++) {
+		if (started[i]) {
+			pthread_join(self->threads[i], NULL);
+		} else {
+			ssd1306_group_worker(&self->jobs[i]);
+		}
+	}
+	Py_END_ALLOW_THREADS
+
+	for (i=0; i<PyTuple_GET_SIZE(self->displays); i++) {
+		((SSD1306PyObject *)PyTuple_GET_ITEM(self->displays, i))->busy = 0;
+	}
+
+	// report the first failed panel, forget errors of the others
+	for (i=0; i<PyTuple_GET_SIZE(self->displays); i++) {
+		if (ssd1306_ioCheck((SSD1306PyObject *)PyTuple_GET_ITEM(self->displays, i)) < 0) {
+			for (i++; i<PyTuple_GET_SIZE(self->displays); i++) {
+				((SSD1306PyObject *)PyTuple_GET_ITEM(self->displays, i))->io_errno = 0;
+			}
+			return NULL;
+		}
+	}
+
+	Py_RETURN_NONE;
+}
+
+static Py_ssize_t
+ssd1306_group_length(SSD1306GroupPyObject *self) {
+	return self->displays ? PyTuple_GET_SIZE(self->displays) : 0;
+}
+
+static PyObject *
+ssd1306_group_item(SSD1306GroupPyObject *self, Py_ssize_t i) {
+	if (self->displays == NULL || i < 0 || i >= PyTuple_GET_SIZE(self->displays)) {
+		PyErr_SetString(PyExc_IndexError, "SSD1306Group index out of range");
+		return NULL;
+	}
+
+	Py_INCREF(PyTuple_GET_ITEM(self->displays, i));
+	return PyTuple_GET_ITEM(self->displays, i);
+}
+
+static PySequenceMethods ssd1306_group_as_sequence = {
+	(lenfunc)ssd1306_group_length,	/* sq_length */
+	0,				/* sq_concat */
+	0,				/* sq_repeat */
+	(ssizeargfunc)ssd1306_group_item,	/* sq_item */
+};
+
+static PyMethodDef ssd1306_group_methods[] = {
+	{"update", (PyCFunction)ssd1306_group_update, METH_NOARGS,
+		"update()\n\n Update all OLED displays of the group, one native thread per I2C bus."},
+	{NULL}
+};
+
+static PyTypeObject SSD1306GroupObjectType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"SSD1306Group",		/* tp_name        */
+	sizeof(SSD1306GroupPyObject),	/* tp_basicsize   */
+	0,				/* tp_itemsize    */
+	(destructor)ssd1306_group_dealloc,	/* tp_dealloc     */
+	0,				/* tp_print       */
+	0,				/* tp_getattr     */
+	0,				/* tp_setattr     */
+	0,				/* tp_compare     */
+	0,				/* tp_repr        */
+	0,				/* tp_as_number   */
+	&ssd1306_group_as_sequence,	/* tp_as_sequence */
+	0,				/* tp_as_mapping  */
+	0,				/* tp_hash        */
+	0,				/* tp_call        */
+	0,				/* tp_str         */
+	0,				/* tp_getattro    */
+	0,				/* tp_setattro    */
+	0,				/* tp_as_buffer   */
+	Py_TPFLAGS_DEFAULT,		/* tp_flags       */
+	"SSD1306Group(displays) -> group\n\nReturn a group of SSD1306 objects updated together. Panels on different I2C buses are flushed in parallel.\n",	/* tp_doc         */
+	0,				/* tp_traverse       */
+	0,				/* tp_clear          */
+	0,				/* tp_richcompare    */
+	0,				/* tp_weaklistoffset */
+	0,				/* tp_iter           */
+	0,				/* tp_iternext       */
+	ssd1306_group_methods,	/* tp_methods        */
+	ssd1306_group_members,	/* tp_members        */
+	0,				/* tp_getset         */
+	0,				/* tp_base           */
+	0,				/* tp_dict           */
+	0,				/* tp_descr_get      */
+	0,				/* tp_descr_set      */
+	0,				/* tp_dictoffset     */
+	(initproc)ssd1306_group_init,	/* tp_init           */
+};
+
+#define MODULE_DOC	"Python bindings for SSD1306 OLED display via I2C bus"
+
+#if PY_MAJOR_VERSION >= 3
+static struct PyModuleDef ssd1306_module = {
+	PyModuleDef_HEAD_INIT,
+	"ssd1306_i2c",	/* m_name */
+	MODULE_DOC,		/* m_doc  */
+	-1,				/* m_size */
+	NULL,			/* m_methods */
+};
+#endif
+
+static PyObject *
+ssd1306_initModule(void)
 {
 	PyObject* m;
 
-	SSD1306ObjectType.tp_new = PyType_GenericNew;
+	glyph_expand_init();
+
+	CanvasObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&CanvasObjectType) < 0)
+		return NULL;
+
+	SSD1306ObjectType.tp_base = &CanvasObjectType;
+	SSD1306ObjectType.tp_new = ssd1306_new;
 	if (PyType_Ready(&SSD1306ObjectType) < 0)
-		return;
+		return NULL;
+
+	SSD1306GroupObjectType.tp_new = PyType_GenericNew;
+	if (PyType_Ready(&SSD1306GroupObjectType) < 0)
+		return NULL;
 
-	m = Py_InitModule3("ssd1306_i2c", NULL,
-		   "Python bindings for SSD1306 OLED display via I2C bus");
+#if PY_MAJOR_VERSION >= 3
+	m = PyModule_Create(&ssd1306_module);
+#else
+	m = Py_InitModule3("ssd1306_i2c", NULL, MODULE_DOC);
+#endif
 	if (m == NULL)
-		return;
+		return NULL;
+
+	Py_INCREF(&CanvasObjectType);
+	PyModule_AddObject(m, "Canvas", (PyObject *)&CanvasObjectType);
 
 	Py_INCREF(&SSD1306ObjectType);
 	PyModule_AddObject(m, "SSD1306", (PyObject *)&SSD1306ObjectType);
+
+	Py_INCREF(&SSD1306GroupObjectType);
+	PyModule_AddObject(m, "SSD1306Group", (PyObject *)&SSD1306GroupObjectType);
+
+	return m;
+}
+
+#if PY_MAJOR_VERSION >= 3
+PyMODINIT_FUNC
+PyInit_ssd1306_i2c(void)
+{
+	return ssd1306_initModule();
+}
+#else
+PyMODINIT_FUNC
+initssd1306_i2c(void) 
+{
+	ssd1306_initModule();
 }
+#endif